@@ -43,7 +43,14 @@ HEADERS += include/MainWindow.h \
            include/Scene.h \
            include/Buffer.h \
     include/marchingcube.h \
-    include/signed_distance_field_from_mesh.hpp
+    include/ParallelFor.h \
+    include/SignedDistanceField.h \
+    include/FieldCache.h \
+    include/OffsetBlend.h \
+    include/MeshBoundsTree.h \
+    include/SignMask.h \
+    include/CellKernel.h \
+    include/BoundedQueue.h
 
 
 SOURCES += src/main.cpp \
@@ -54,7 +61,13 @@ SOURCES += src/main.cpp \
            src/Shader.cpp \
            src/Scene.cpp \
            src/Buffer.cpp \
-           src/marchingcube.cpp
+           src/marchingcube.cpp \
+           src/ParallelFor.cpp \
+           src/SignedDistanceField.cpp \
+           src/FieldCache.cpp \
+           src/OffsetBlend.cpp \
+           src/MeshBoundsTree.cpp \
+           src/SignMask.cpp
 
 OTHER_FILES += shaders/* \
                models/* \
@@ -66,7 +79,7 @@ UI_HEADERS_DIR = ui
 OBJECTS_DIR = obj
 UI_DIR = ui
 
-linux:LIBS += -lGL -lGLU -lGLEW -L ./lib/ -lsdf-lite-linuxgcc-mt
+linux:LIBS += -lGL -lGLU -lGLEW
 
 
 #DISTFILES +=
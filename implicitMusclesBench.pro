@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+# Pipeline benchmarks printing JSON, no Qt modules or OpenGL
+#
+#-------------------------------------------------
+
+QT -= core gui
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+TEMPLATE = app
+TARGET = implicitMusclesBench
+
+INCLUDEPATH += $$PWD/include \
+               $$PWD/glm
+
+HEADERS += include/marchingcube.h \
+           include/ParallelFor.h \
+           include/SignedDistanceField.h \
+           include/FieldCache.h \
+           include/OffsetBlend.h \
+           include/MeshBoundsTree.h \
+           include/SignMask.h \
+           include/CellKernel.h \
+           include/BoundedQueue.h
+
+SOURCES += src/bench.cpp \
+           src/marchingcube.cpp \
+           src/ParallelFor.cpp \
+           src/SignedDistanceField.cpp \
+           src/FieldCache.cpp \
+           src/OffsetBlend.cpp \
+           src/MeshBoundsTree.cpp \
+           src/SignMask.cpp
+
+OBJECTS_DIR = obj/bench
+
+linux:LIBS += -lpthread
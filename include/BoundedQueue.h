@@ -0,0 +1,106 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Fixed capacity queue for any number of producer and consumer threads, without locks. Each cell carries a
+/// sequence number telling whether it is free for the producer of a given turn or full for its consumer, so a thread
+/// only ever claims a position with one compare and swap (Vyukov's bounded queue). push and pop fail instead of
+/// waiting, the caller decides whether to retry or do other work
+//----------------------------------------------------------------------------------------------------------------------
+template<typename T>
+class BoundedQueue
+{
+public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Constructor
+    /// @param [in] _capacity the most values held at once, rounded up to a power of two
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit BoundedQueue(size_t _capacity)
+    {
+        size_t capacity = 2;
+        while(capacity < _capacity)
+            capacity *= 2;
+
+        m_mask = capacity - 1;
+        m_cells.reset(new Cell[capacity]);
+        for(size_t i = 0; i < capacity; i++)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        m_enqueue.store(0, std::memory_order_relaxed);
+        m_dequeue.store(0, std::memory_order_relaxed);
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Adds _value at the back
+    /// @return false when the queue is full
+    //----------------------------------------------------------------------------------------------------------------------
+    bool push(const T &_value)
+    {
+        size_t position = m_enqueue.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            Cell &cell = m_cells[position & m_mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t turn = std::ptrdiff_t(sequence) - std::ptrdiff_t(position);
+            if(turn == 0)
+            {
+                if(m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.value = _value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(turn < 0)
+                return false;
+            else
+                position = m_enqueue.load(std::memory_order_relaxed);
+        }
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Takes the value at the front
+    /// @return false when the queue is empty
+    //----------------------------------------------------------------------------------------------------------------------
+    bool pop(T &o_value)
+    {
+        size_t position = m_dequeue.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            Cell &cell = m_cells[position & m_mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t turn = std::ptrdiff_t(sequence) - std::ptrdiff_t(position + 1);
+            if(turn == 0)
+            {
+                if(m_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    o_value = cell.value;
+                    cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(turn < 0)
+                return false;
+            else
+                position = m_dequeue.load(std::memory_order_relaxed);
+        }
+    }
+
+private:
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Next positions to push and pop, on their own cache lines so producers and consumers do not share one
+    alignas(64) std::atomic<size_t> m_enqueue;
+    alignas(64) std::atomic<size_t> m_dequeue;
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,48 @@
+#ifndef FIELDCACHE_H
+#define FIELDCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Header of a sampled field cache file, followed by dims[0]*dims[1]*dims[2] values in the layout of
+/// MarchingCube::volumeData. A cache is only valid for the mesh content and the grid it was sampled with
+//----------------------------------------------------------------------------------------------------------------------
+struct FieldCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    /// @brief 0 for 32 bit floats, 1 for 16 bit halves
+    uint32_t format;
+    uint32_t dims[3];
+    float bboxMin[3];
+    float bboxMax[3];
+    /// @brief Keeps meshHash aligned without uninitialised padding in the file
+    uint32_t reserved;
+    /// @brief Hash of the content of the obj file the field was sampled from
+    uint64_t meshHash;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief 64 bit FNV-1a hash of the content of a file
+/// @param [out] o_hash the hash, only written on success
+/// @return false if the file could not be read
+//----------------------------------------------------------------------------------------------------------------------
+bool hashFile(const std::string &_path, uint64_t &o_hash);
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Maps a cache file and copies its field into o_field if its header matches the expected format, grid and hash
+/// @param [in] _expected the header the file must have, magic and version are ignored
+/// @return false if there is no cache or it is stale, o_field is then left untouched
+//----------------------------------------------------------------------------------------------------------------------
+bool loadFieldCache(const std::string &_path, const FieldCacheHeader &_expected, std::vector<float> &o_field);
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Writes a field and its header to a cache file, the magic and version are filled in
+/// @param [in] _half store the values as 16 bit halves, half the size for about 3 significant digits
+/// @return false if the file could not be written
+//----------------------------------------------------------------------------------------------------------------------
+bool saveFieldCache(const std::string &_path, FieldCacheHeader _header, const std::vector<float> &_field, bool _half = false);
+
+#endif // FIELDCACHE_H
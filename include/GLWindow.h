@@ -70,6 +70,9 @@ private :
   GLuint m_vbo2;
   //----------------------------------------------------------------------------------------------------------------------
   GLuint m_nbo2;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief Element buffer, only used when the meshes are indexed
+  GLuint m_ibo;
 
 
   //----------------------------------------------------------------------------------------------------------------------
@@ -123,6 +126,12 @@ private :
   //------------------------------------------------------------------------------------------------
   int muscleTotalVertices();
   int boneTotalVertices();
+  int muscleTotalIndices();
+  int boneTotalIndices();
+  //------------------------------------------------------------------------------------------------
+  /// Concatenates the indices of every mesh at an offset level, shifted to the vertices in
+  /// m_renderArray, and uploads them to m_ibo
+  void loadIndices(int _offsetLevel);
 
 
 };
@@ -0,0 +1,58 @@
+#ifndef MESHBOUNDSTREE_H
+#define MESHBOUNDSTREE_H
+
+#include <glm.hpp>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Bounding volume hierarchy over the bounding boxes of whole meshes, the top level above the hierarchy of
+/// each SignedDistanceField. Finds the meshes near a point or a box without testing every mesh of the rig.
+/// Nodes are flattened depth first like in SignedDistanceField
+//----------------------------------------------------------------------------------------------------------------------
+class MeshBoundsTree
+{
+public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Builds the hierarchy, replacing the previous one
+    /// @param [in] _min, _max the corners of the box of each mesh, the index of a box is its id. Empty boxes, with a
+    /// minimum above the maximum, are left out
+    //----------------------------------------------------------------------------------------------------------------------
+    void build(const std::vector<glm::vec3> &_min, const std::vector<glm::vec3> &_max);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The ids of the boxes closer than _radius to the box [_min, _max], in increasing order
+    /// @param [out] o_ids cleared first
+    //----------------------------------------------------------------------------------------------------------------------
+    void query(const glm::vec3 &_min, const glm::vec3 &_max, float _radius, std::vector<unsigned int> &o_ids) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Squared distance from _p to the box of the mesh with id _id, 0 inside
+    //----------------------------------------------------------------------------------------------------------------------
+    float distance2(unsigned int _id, const glm::vec3 &_p) const;
+
+private:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Leaves have a non zero count and offset is their first box, inner nodes have a count of 0, their left
+    /// child is the next node and offset is the right child
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Node
+    {
+        glm::vec3 bmin;
+        unsigned int offset;
+        glm::vec3 bmax;
+        unsigned int count;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Recursively builds the hierarchy over m_order[_first, _first + _count), splitting at the median centre
+    /// along the longest axis
+    //----------------------------------------------------------------------------------------------------------------------
+    void build(unsigned int _first, unsigned int _count);
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<Node> m_nodes;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Ids of the boxes in leaf order
+    std::vector<unsigned int> m_order;
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<glm::vec3> m_min;
+    std::vector<glm::vec3> m_max;
+};
+
+#endif // MESHBOUNDSTREE_H
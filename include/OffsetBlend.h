@@ -0,0 +1,133 @@
+#ifndef OFFSETBLEND_H
+#define OFFSETBLEND_H
+
+#include <cmath>
+#include <glm.hpp>
+
+// The blending operator of MarchingCube::offsetMesh. It pushes the current muscle out by the offset, except where that
+// would take it into another muscle or a bone. blendKernel takes the number of meshes, and blendKernel<NumDynamic,
+// NumStatic> passes it as constants so the compiler can unroll the min/max chain for the common rigs.
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Distance standing for a mesh too far from a sample to take part in its blend. It never wins the min/max
+/// chain against a real distance and keeps blendRatio finite, the blend is the limit of the mesh moving away
+//----------------------------------------------------------------------------------------------------------------------
+const float c_farNeighbour = 1e30f;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief The offset at height _y, scaled down to a tenth towards the joint at y = 6
+//----------------------------------------------------------------------------------------------------------------------
+inline float offsetAtHeight(float _offset, float _y)
+{
+    float t = fabs(_y - 6.0)*0.2;
+    if (t < 0.0) t = 0.0;
+    if (t > 1.0) t = 1.0;
+    return _offset*(t*0.1 + (1.0-t));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief The fraction of the offset applied for a bound of the blend, 0 outside of the other meshes
+//----------------------------------------------------------------------------------------------------------------------
+inline float blendRatio(float _bound)
+{
+    float r = 0;
+    if(_bound < 0.0)
+    {
+        float fa = fabs(_bound/0.1);
+        r = fa/(fa + 1.0);
+    }
+    return r;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Blended distance of the current muscle
+/// @param [in] _src distances of the dynamic meshes, current muscle first then the others in order
+/// @param [in] _noDynamic, _noStatic the number of distances in _src and _sta
+/// @param [in] _sta distances of the static meshes
+/// @param [in] _localOffset the offset at the height of the sample, see offsetAtHeight
+/// @return 0 when there is no dynamic mesh
+//----------------------------------------------------------------------------------------------------------------------
+inline float blendKernel(const float *_src, int _noDynamic, const float *_sta, int _noStatic, float _localOffset)
+{
+    if(_noDynamic < 1)
+        return 0;
+    if(_noDynamic == 1 && _noStatic == 0)
+        return _src[0] - _localOffset;
+
+    const float ub0 = _src[0] - _localOffset;
+    float dyn;
+    float oth;
+    if(_noDynamic == 1)
+    {
+        oth = _sta[0];
+        for(int s = 1; s < _noStatic; s++)
+            oth = glm::min(oth, _sta[s]);
+        dyn = ub0 - oth;
+    }
+    else
+    {
+        dyn = ub0 - (_src[1] - _localOffset);
+        oth = _src[1];
+        for(int i = 2; i < _noDynamic; i++)
+        {
+            dyn = glm::max(dyn, ub0 - (_src[i] - _localOffset));
+            oth = glm::min(oth, _src[i]);
+        }
+        for(int s = 0; s < _noStatic; s++)
+            oth = glm::min(oth, _sta[s]);
+    }
+
+    const float bound = glm::max(glm::min(dyn, _src[0]), -oth);
+    return _src[0] - (_localOffset*blendRatio(bound));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief blendKernel for counts known at compile time, which become constants once inlined so the compiler can
+/// unroll the min/max chain
+//----------------------------------------------------------------------------------------------------------------------
+template<int NumDynamic, int NumStatic>
+inline float blendKernel(const float *_src, const float *_sta, float _localOffset)
+{
+    static_assert(NumDynamic >= 1, "the current muscle is always one of the dynamic meshes");
+    return blendKernel(_src, NumDynamic, _sta, NumStatic, _localOffset);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Blends a row of samples that share a height
+/// @param [in] _noDynamic, _noStatic the number of rows in _dynamic and _static, ignored by the templated kernels
+/// @param [in] _dynamic one row of _count distances per dynamic mesh, current muscle first
+/// @param [in] _static one row of _count distances per static mesh
+/// @param [out] o_row the _count blended distances
+//----------------------------------------------------------------------------------------------------------------------
+typedef void (*BlendRowKernel)(int _noDynamic, int _noStatic, const float *const *_dynamic, const float *const *_static,
+                               unsigned int _count, float _localOffset, float *o_row);
+
+template<int NumDynamic, int NumStatic>
+void blendRowKernel(int, int, const float *const *_dynamic, const float *const *_static,
+                    unsigned int _count, float _localOffset, float *o_row)
+{
+    for(unsigned int k = 0; k < _count; k++)
+    {
+        float src[NumDynamic];
+        float sta[NumStatic > 0 ? NumStatic : 1];
+        for(int i = 0; i < NumDynamic; i++)
+            src[i] = _dynamic[i][k];
+        for(int s = 0; s < NumStatic; s++)
+            sta[s] = _static[s][k];
+
+        o_row[k] = blendKernel<NumDynamic, NumStatic>(src, sta, _localOffset);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief The row kernel for any number of meshes
+//----------------------------------------------------------------------------------------------------------------------
+void blendRowGeneric(int _noDynamic, int _noStatic, const float *const *_dynamic, const float *const *_static,
+                     unsigned int _count, float _localOffset, float *o_row);
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief The specialised row kernel for a rig, or blendRowGeneric when there is none for its counts
+//----------------------------------------------------------------------------------------------------------------------
+BlendRowKernel selectBlendRowKernel(int _noDynamic, int _noStatic);
+
+#endif // OFFSETBLEND_H
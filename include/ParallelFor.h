@@ -0,0 +1,25 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <functional>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Resolves a requested thread count, 0 meaning one thread per hardware core
+/// @param [in] _threads the requested number of threads
+/// @return the number of threads to use, never less than 1
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int resolveThreadCount(unsigned int _threads);
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Calls _func(i) for every i in [_begin,_end) using a pool of worker threads.
+/// Items are handed out one at a time from a shared counter, so a thread that finishes a cheap slab
+/// simply takes the next one instead of waiting on a fixed partition. _func must only write to data
+/// owned by item i for the result to be independent of the thread count.
+/// @param [in] _begin first item
+/// @param [in] _end one past the last item
+/// @param [in] _threads number of worker threads, 0 uses every hardware core
+/// @param [in] _func the work for a single item
+//----------------------------------------------------------------------------------------------------------------------
+void parallelFor(unsigned int _begin, unsigned int _end, unsigned int _threads, const std::function<void(unsigned int)> &_func);
+
+#endif // PARALLELFOR_H
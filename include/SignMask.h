@@ -0,0 +1,63 @@
+#ifndef SIGNMASK_H
+#define SIGNMASK_H
+
+#include <cmath>
+#include <cstdint>
+
+// One bit per sample telling whether it is below the isolevel, 64 samples of a row per word. Most cells of a volume
+// are far from the surface, the cells with corners on both sides are found a word at a time from the masks of their
+// four rows and only those go through the marching cubes.
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Number of words holding the bits of a row of _count samples
+//----------------------------------------------------------------------------------------------------------------------
+inline unsigned int signMaskWords(unsigned int _count)
+{
+    return (_count + 63)/64;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief The float threshold t for which _value < t gives the same answer as comparing _value with the double
+/// _isolevel, when the isolevel has no exact float
+//----------------------------------------------------------------------------------------------------------------------
+inline float signMaskThreshold(double _isolevel)
+{
+    const float iso = static_cast<float>(_isolevel);
+    // rounded down, the floats equal to iso are still below the isolevel
+    return static_cast<double>(iso) < _isolevel ? std::nextafter(iso, INFINITY) : iso;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Sets bit k of o_bits when _values[k] < _isolevel, with vector compares where available
+/// @param [out] o_bits signMaskWords(_count) words, the bits past _count are cleared
+//----------------------------------------------------------------------------------------------------------------------
+void signMaskRow(const float *_values, unsigned int _count, float _isolevel, uint64_t *o_bits);
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief The cells of a row with corners on both sides of the isolevel
+/// @param [in] _rows the masks of the four rows of samples around the row of cells, from signMaskRow
+/// @param [in] _count the number of samples in a row, the row has _count-1 cells
+/// @param [out] o_active signMaskWords(_count) words, bit k set when cell k, between samples k and k+1, is crossed
+/// @return true when any cell of the row is crossed
+//----------------------------------------------------------------------------------------------------------------------
+bool activeCells(const uint64_t *const *_rows, unsigned int _count, uint64_t *o_active);
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief The index of the lowest set bit of _word, which must not be 0
+//----------------------------------------------------------------------------------------------------------------------
+inline unsigned int lowestBit(uint64_t _word)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned int>(__builtin_ctzll(_word));
+#else
+    unsigned int bit = 0;
+    while(!(_word & 1))
+    {
+        _word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+#endif // SIGNMASK_H
@@ -0,0 +1,223 @@
+#ifndef SIGNEDDISTANCEFIELD_H
+#define SIGNEDDISTANCEFIELD_H
+
+#include <glm.hpp>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Exact signed distance to a triangle mesh, negative inside and positive outside.
+/// Triangles are stored in a flattened bounding volume hierarchy, nodes are laid out depth first so the
+/// left child of a node always follows it in memory. The sign comes from the angle weighted pseudo-normal
+/// of the closest feature (face, edge or vertex), so the mesh has to be closed and consistently wound.
+/// The interface mirrors the one of the sdf-lite library it replaces.
+//----------------------------------------------------------------------------------------------------------------------
+class SignedDistanceField
+{
+public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Work done by queries, accumulated by the calls that are given one. Not thread safe, use one per thread
+    //----------------------------------------------------------------------------------------------------------------------
+    struct QueryStats
+    {
+        unsigned long long queries = 0;
+        unsigned long long nodes = 0;
+        unsigned long long triangles = 0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Marks a hint that holds no triangle yet
+    //----------------------------------------------------------------------------------------------------------------------
+    static const unsigned int c_noHint = ~0u;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Default constructor, load_from_file or load_from_data has to be called before sampling
+    //----------------------------------------------------------------------------------------------------------------------
+    SignedDistanceField();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Constructor loading an obj file
+    /// @param [in] _filename path to the obj file
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit SignedDistanceField(const std::string &_filename);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Loads an obj file, polygons are triangulated as fans
+    /// @param [in] _filename path to the obj file
+    /// @return true if the file was read and contained at least one triangle
+    //----------------------------------------------------------------------------------------------------------------------
+    bool load_from_file(const std::string &_filename);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Builds the field from an indexed triangle list
+    /// @param [in] _indices three indices per triangle, starting from 0
+    /// @param [in] _nindices number of indices
+    /// @param [in] _vertices pointer to the first float of the first position
+    /// @param [in] _nvertices number of vertices
+    /// @param [in] _vertexStride gap in bytes between two positions
+    /// @return true if the mesh contained at least one non degenerate triangle
+    //----------------------------------------------------------------------------------------------------------------------
+    bool load_from_data(const unsigned int *_indices, unsigned int _nindices,
+                        const float *_vertices, unsigned int _nvertices, unsigned int _vertexStride = sizeof(float)*3);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Whether a mesh has been loaded
+    //----------------------------------------------------------------------------------------------------------------------
+    bool is_valid() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Signed distance from (x,y,z) to the mesh
+    /// @param [out] o_closest optional, the closest point on the surface
+    /// @return the signed distance, or the maximum float if no mesh is loaded
+    //----------------------------------------------------------------------------------------------------------------------
+    float operator()(float x, float y, float z, float *o_closest = 0) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Signed distance from (x,y,z) to the mesh, only searching within _maxRadius
+    /// @param [in] _maxRadius the search radius, triangles further away are never visited
+    /// @param [out] o_sdf the signed distance, only written when the surface is closer than _maxRadius
+    /// @param [out] o_closest optional, the closest point on the surface
+    /// @return true if the surface is closer than _maxRadius
+    //----------------------------------------------------------------------------------------------------------------------
+    bool operator()(float x, float y, float z, float _maxRadius, float *o_sdf, float *o_closest = 0) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Signed distance from (x,y,z) to the mesh, warm started from the closest triangle of a nearby point.
+    /// The distance to the hinted triangle bounds the search from the start, so most of the hierarchy is pruned
+    /// straight away. The result is still exact, a poor hint only costs one extra triangle test
+    /// @param [in,out] io_hint the triangle to start from or c_noHint, replaced by the closest triangle of this point
+    /// @param [in,out] io_stats optional, accumulates the work done
+    //----------------------------------------------------------------------------------------------------------------------
+    float query_with_hint(float x, float y, float z, unsigned int &io_hint, QueryStats *io_stats = 0) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Signed distances of _count points given as separate x, y and z arrays.
+    /// Points are traversed in packets of c_packetSize, sharing the box tests of the hierarchy, so coherent points
+    /// such as a row of voxels are much cheaper than separate queries. Each packet is warm started from the closest
+    /// triangles of the previous one, see query_with_hint. Matches operator() up to rounding
+    /// @param [out] o_sdf _count distances, the maximum float for every point if no mesh is loaded
+    /// @param [in,out] io_hint optional, the triangle to start the first packet from, replaced by the closest triangle
+    /// of the first point so the next row can start from it
+    /// @param [in,out] io_stats optional, accumulates the work done
+    //----------------------------------------------------------------------------------------------------------------------
+    void batch_query(const float *_x, const float *_y, const float *_z, unsigned int _count, float *o_sdf,
+                     unsigned int *io_hint = 0, QueryStats *io_stats = 0) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief batch_query only searching within _maxRadius of each point, far points are answered from the top of
+    /// the hierarchy
+    /// @param [out] o_sdf _count distances, the maximum float for points further than _maxRadius from the surface
+    //----------------------------------------------------------------------------------------------------------------------
+    void batch_query(const float *_x, const float *_y, const float *_z, unsigned int _count, float _maxRadius, float *o_sdf,
+                     unsigned int *io_hint = 0, QueryStats *io_stats = 0) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Number of points traversed together by batch_query, 8 with AVX, 4 with SSE and 1 otherwise
+    //----------------------------------------------------------------------------------------------------------------------
+    static const unsigned int c_packetSize;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The lowest corner of the mesh bounding box
+    //----------------------------------------------------------------------------------------------------------------------
+    const float *minimum_bound() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The highest corner of the mesh bounding box
+    //----------------------------------------------------------------------------------------------------------------------
+    const float *maximum_bound() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The box of the mesh along its principal axes, the eigenvectors of the covariance of its vertices
+    /// @param [out] o_axes three unit axes forming a right handed frame, the longest spread of the vertices last
+    /// @param [out] o_min, o_max the bounds of the vertices along each axis, as dot products with it
+    //----------------------------------------------------------------------------------------------------------------------
+    void oriented_bounds(glm::vec3 *o_axes, glm::vec3 &o_min, glm::vec3 &o_max) const;
+
+private:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief A 32 byte hierarchy node. Leaves have a non zero count and offset is their first triangle,
+    /// inner nodes have a count of 0, their left child is the next node and offset is the right child
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Node
+    {
+        float bmin[3];
+        unsigned int offset;
+        float bmax[3];
+        unsigned int count;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Triangle corners, stored in leaf order so a leaf reads a contiguous block
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Triangle
+    {
+        glm::vec3 a;
+        glm::vec3 b;
+        glm::vec3 c;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Pseudo-normals of the face, its edges (ab, bc, ca) and its corners (a, b, c).
+    /// Kept apart from the corners as they are only read for the closest triangle
+    //----------------------------------------------------------------------------------------------------------------------
+    struct PseudoNormals
+    {
+        glm::vec3 face;
+        glm::vec3 edge[3];
+        glm::vec3 vertex[3];
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Which part of a triangle a closest point lies on
+    //----------------------------------------------------------------------------------------------------------------------
+    enum Feature { FACE, EDGE_AB, EDGE_BC, EDGE_CA, VERTEX_A, VERTEX_B, VERTEX_C };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Closest point on triangle _t to _p, from Real-Time Collision Detection (Ericson) 5.1.5
+    //----------------------------------------------------------------------------------------------------------------------
+    static glm::vec3 closestPointOnTriangle(const glm::vec3 &_p, const Triangle &_t, Feature &o_feature);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Squared distance from _p to the box of _node, 0 inside
+    //----------------------------------------------------------------------------------------------------------------------
+    static float boxDistance2(const glm::vec3 &_p, const Node &_node);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Finds the closest triangle to _p whose squared distance is below io_dist2
+    /// @param [in,out] io_stats optional, counts the nodes visited and triangles tested
+    /// @return true if one was found, in which case io_dist2, o_triangle and o_closest are updated
+    //----------------------------------------------------------------------------------------------------------------------
+    bool closest(const glm::vec3 &_p, float &io_dist2, unsigned int &o_triangle, glm::vec3 &o_closest, Feature &o_feature,
+                 QueryStats *io_stats = 0) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief closest for a packet of Lanes::c_width points, the boxes are tested for every point at once and a node
+    /// is visited while it may hold the closest triangle of any point of the packet
+    /// @param [out] o_sdf the signed distance of each point
+    /// @param [in] _maxDist2 squared search radius, points with nothing closer get the maximum float
+    /// @param [in,out] io_triangles the closest triangle of each point of the previous packet, or c_noHint, replaced by
+    /// the ones of this packet
+    //----------------------------------------------------------------------------------------------------------------------
+    template <typename Lanes>
+    void closestPacket(const float *_x, const float *_y, const float *_z, float _maxDist2, float *o_sdf, unsigned int *io_triangles, QueryStats &io_stats) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The two batch_query, _maxDist2 is the squared search radius
+    //----------------------------------------------------------------------------------------------------------------------
+    void batchQuery(const float *_x, const float *_y, const float *_z, unsigned int _count, float _maxDist2, float *o_sdf,
+                    unsigned int *io_hint, QueryStats *io_stats) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Signs the distance to o_closest using the pseudo-normal of the closest feature
+    //----------------------------------------------------------------------------------------------------------------------
+    float signedDistance(const glm::vec3 &_p, float _dist2, unsigned int _triangle, const glm::vec3 &_closest, Feature _feature) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Recursively builds the hierarchy over m_triangles[_first, _first + _count) with a binned surface area
+    /// heuristic, then median splits from a fixed depth on so the traversal stacks always suffice
+    /// @param [in] _depth depth of the node being built, 0 at the root
+    /// @param [in,out] io_centroids triangle centroids, reordered alongside m_triangles
+    /// @param [in,out] io_order original triangle index of each slot, reordered alongside m_triangles
+    //----------------------------------------------------------------------------------------------------------------------
+    void build(unsigned int _first, unsigned int _count, unsigned int _depth, std::vector<glm::vec3> &io_centroids,
+               std::vector<unsigned int> &io_order);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Reorders m_triangles[_first, _first + _count) so the lower half of the centroids along the longest axis of
+    /// _extent comes first. Does nothing when the centroids all coincide
+    //----------------------------------------------------------------------------------------------------------------------
+    void splitAtMedian(unsigned int _first, unsigned int _count, const glm::vec3 &_extent,
+                       std::vector<glm::vec3> &io_centroids, std::vector<unsigned int> &io_order);
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<Node> m_nodes;
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<Triangle> m_triangles;
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<PseudoNormals> m_normals;
+    //----------------------------------------------------------------------------------------------------------------------
+    float m_min[3];
+    //----------------------------------------------------------------------------------------------------------------------
+    float m_max[3];
+    //----------------------------------------------------------------------------------------------------------------------
+    glm::vec3 m_axes[3];
+    //----------------------------------------------------------------------------------------------------------------------
+    glm::vec3 m_orientedMin;
+    //----------------------------------------------------------------------------------------------------------------------
+    glm::vec3 m_orientedMax;
+};
+
+#endif // SIGNEDDISTANCEFIELD_H
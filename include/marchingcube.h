@@ -1,22 +1,16 @@
 #ifndef MARCHINGCUBE_H
 #define MARCHINGCUBE_H
 
-#ifdef __APPLE__
-#include <OpenGL/gl3.h>
-#else
-#include <GL/glew.h>
-#endif
-
 #include <glm.hpp>
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <string>
 #include <vector>
 
-#include <QOpenGLWidget>
-#include <QResizeEvent>
-#include <QEvent>
-
-#include "signed_distance_field_from_mesh.hpp"
+#include "MeshBoundsTree.h"
+#include "OffsetBlend.h"
+#include "SignedDistanceField.h"
 
 
 /// @author Xiasong Yang
@@ -72,10 +66,13 @@ public:
     unsigned int    volume_height;
     unsigned int    volume_depth;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief The volume data
+    /// @brief The volume data, x slabs of y rows of z samples
     //----------------------------------------------------------------------------------------------------------------------
     float           *volumeData;
     unsigned int m_volume_size;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Position of sample (i,j,k) in volumeData
+    unsigned int voxelIndex(unsigned int i, unsigned int j, unsigned int k) const { return (i*volume_height + j)*volume_depth + k; }
     //----------------------------------------------------------------------------------------------------------------------   
     /// @brief Polygonize prepared isosurfaces
     /// @author Xiasong Yang
@@ -97,10 +94,178 @@ public:
     /// Prepares the sdf volume for marching cubes
     bool PrepareVolume(int meshNo, bool _static);
     //----------------------------------------------------------------------------------------------------------------------
-    std::vector <VertData> m_vboMesh;
+    /// @brief Samples the field of a dynamic (offset) or static mesh at pos
+    float sampleVolume(glm::vec3 pos, int meshNo, bool _static);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sampleVolume for a row of count points of the grid, see rowPositions, using the batched sdf query of
+    /// each mesh
+    /// @param [out] o_row count samples
+    /// @param [in,out] io_hints warm start triangles of the dynamic meshes then the static ones, see
+    /// SignedDistanceField::batch_query. Start them at c_noHint and pass them on to the next row
+    void sampleRow(const float *x, const float *y, const float *z, unsigned int count, int meshNo, bool _static, float *o_row, unsigned int *io_hints);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sampleRow at several offsets, the distances to the meshes are only queried once for all of them. The
+    /// lazy radius is the one of m_offset, which must be the largest of _offsets in magnitude
+    /// @param [out] o_rows one row of count samples per offset
+    void sampleRows(const float *x, const float *y, const float *z, unsigned int count, int meshNo, bool _static,
+                    const float *_offsets, unsigned int _noOffsets, float *const *o_rows, unsigned int *io_hints);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The part of sampleRow that only needs the mesh being sampled. Fills o_row at the samples away from the
+    /// surface, see m_lazyOffset, and lists the others in o_near
+    /// @param [out] o_distances count distances to the mesh, the maximum float at the samples beyond the lazy radius
+    /// @param [in,out] io_hint warm start triangle of the mesh
+    void sampleOwnRow(const float *x, const float *y, const float *z, unsigned int count, int meshNo, bool _static,
+                      float *o_row, float *o_distances, std::vector<unsigned int> &o_near, unsigned int *io_hint);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Only query the other muscles and the bone where the offset blend can move the surface across a cell.
+    /// Elsewhere the distance to the current mesh is searched within a bounded radius and the sample only keeps the
+    /// right side of isolevel, so the extracted meshes are unchanged but the volume holds placeholder values away
+    /// from the surface
+    bool m_lazyOffset = true;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Diagonal of a cell of the grid being sampled, set by PrepareVolume and PolygonizeOctree for sampleRow
+    float m_cellDiagonal = 0.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Narrow band version of PrepareVolume. Each brick of m_brickSize^3 voxels first asks the mesh whether
+    /// it lies within reach of the isosurface, using the bounded sdf query. Only those bricks are sampled, the others
+    /// are filled with a value on the correct side of isolevel, so Polygonize extracts the same mesh
+    void PrepareNarrowBand(int meshNo, bool _static, const float *bbox_min, const float *disp);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Polygonizes a mesh by walking an octree over the bounding box instead of sampling a dense volume.
+    /// Octants further from the mesh than their half diagonal (plus |isolevel| and the offset) cannot contain the
+    /// surface and are pruned with the bounded sdf query, so only leaves of m_brickSize^3 cells next to the
+    /// surface are sampled. The result matches Polygonize at a resolution of m_octreeResolution
+    void PolygonizeOctree(int modelNo, bool _static);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Marching cubes on the prepared volume producing an indexed mesh. Crossed edges are found one x plane
+    /// at a time and their vertex ids cached for the next slab of cells, so each edge creates a single vertex.
+    /// Fills m_verts and m_vertsNormal with one entry per vertex, with smooth normals, and m_indices with the triangles
+    void PolygonizeIndexed();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief An indexed mesh being extracted plane by plane, see indexedPlane
+    struct IndexedSweep
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<unsigned int> indices;
+        /// @brief Vertex ids of the crossed edges starting in the last two x planes, three axes per grid point
+        std::vector<unsigned int> edgeIds[2];
+        /// @brief The plane the sweep starts at, the cells before it are left to the caller
+        unsigned int firstPlane = 0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief One step of PolygonizeIndexed, the vertices on the crossed edges starting in x plane i, then the
+    /// triangles of the cells between planes i-1 and i
+    /// @param [in] _planes the values of planes i-1 to i+2, each laid out like a plane of volumeData, null outside of
+    /// the grid. Plane i+2 is only read for gradient normals
+    void indexedPlane(IndexedSweep &io_sweep, unsigned int i, const float *const *_planes);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Appends the vertices on the crossed edges starting in x plane i to io_sweep, with their gradient normals
+    /// when m_gradientNormals is set, and writes their ids in io_sweep.edgeIds[i & 1], for the crossed edges only
+    /// @param [in] _planes as in indexedPlane
+    void planeVertices(IndexedSweep &io_sweep, unsigned int i, const float *const *_planes);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The triangles of the cells between x planes c and c+1, as vertex ids appended to o_indices
+    /// @param [in] _ids0, _ids1 the vertex ids of planes c and c+1, see planeVertices
+    void slabTriangles(unsigned int c, const float *_plane0, const float *_plane1, const unsigned int *_ids0,
+                       const unsigned int *_ids1, std::vector<unsigned int> &o_indices);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Moves an extracted mesh into m_verts, m_vertsNormal and m_indices
+    void finishIndexed(IndexedSweep &io_sweep);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Marching cubes on the cells between x planes i and i+1, laid out like planes of volumeData
+    /// @return the number of triangles added to o_triangles
+    unsigned int marchSlab(unsigned int i, const float *_plane0, const float *_plane1, std::vector<TRIANGLE> &o_triangles);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Marching cubes on one unit cell with marchCell from CellKernel.h, in float when m_singlePrecision is set
+    /// @param [in] _plane0, _plane1 the x planes on both sides of the cell, rows of _rowSize samples
+    /// @param [in] _first the index of the cell origin in both planes, _origin its position
+    /// @return the number of triangles added to o_triangles
+    unsigned int polygonizeCell(const float *_plane0, const float *_plane1, unsigned int _rowSize, unsigned int _first,
+                                const glm::vec3 &_origin, std::vector<TRIANGLE> &o_triangles) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Packs triangles given in volume coordinates into m_verts and m_vertsNormal
+    void storeTriangles(std::vector<TRIANGLE> &allTriangles);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Number of samples along each axis of the dense volume, recommended 100 - 300
+    unsigned int m_volumeResolution = 300;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The box sampled by PrepareVolume and PolygonizeOctree
+    float m_bboxMin[3] = {-20.0f, -20.0f, -20.0f};
+    float m_bboxMax[3] = {20.0f, 20.0f, 20.0f};
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Sample each mesh over its own bounding box, grown by |isolevel|, the offset and two voxels, instead of
+    /// m_bboxMin and m_bboxMax. Small muscles then cost little and every mesh gets the same detail. The meshes come
+    /// out in world space, and m_cacheFields is ignored as there is no grid shared by all the meshes
+    bool m_tightBounds = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Edge length of a voxel in world units. 0 uses m_volumeResolution (or m_octreeResolution) voxels along
+    /// each axis of m_bboxMin and m_bboxMax
+    float m_voxelSize = 0.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Output the vertices in world units instead of rescaling the sampled box to [-1,1], always on with
+    /// m_tightBounds
+    bool m_worldSpace = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Like m_tightBounds, but each mesh is sampled on a grid along its principal axes, see
+    /// SignedDistanceField::oriented_bounds. A long thin muscle lying across the axes then fills most of its grid
+    /// instead of a small part of its axis aligned box. The meshes come out in world space
+    bool m_orientedBounds = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief With m_orientedBounds, the length of a voxel along the longest principal axis relative to the other
+    /// two. Muscles change little along their length, so above 1 saves samples where they are not needed
+    float m_longAxisScale = 1.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Origin and voxel size of the grid being polygonized, set by PrepareVolume and PolygonizeOctree. With
+    /// m_orientedBounds the origin is along m_gridAxes
+    float m_gridMin[3] = {0.0f, 0.0f, 0.0f};
+    float m_gridDisp[3] = {0.0f, 0.0f, 0.0f};
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The axes of the grid being polygonized when m_gridOriented, the world axes otherwise
+    glm::vec3 m_gridAxes[3] = {glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)};
+    bool m_gridOriented = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The grid a mesh is sampled on, see m_tightBounds, m_orientedBounds and m_voxelSize
+    /// @param [in] _resolution the number of samples along each axis when there is no m_voxelSize
+    /// @param [out] o_min, o_max the sampled box, sample n along an axis is at o_min + o_disp*n
+    /// @param [out] o_disp the voxel size along each axis
+    /// @param [out] o_dims the number of samples along each axis
+    /// @param [out] o_axes the axes of the box, o_min and o_max are along them
+    void samplingGrid(int meshNo, bool _static, unsigned int _resolution, float *o_min, float *o_max, float *o_disp, unsigned int *o_dims, glm::vec3 *o_axes) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Makes the grid from samplingGrid the one being polygonized, sets m_gridMin, m_gridDisp, m_gridAxes and
+    /// m_cellDiagonal
+    void setGrid(const float *_min, const float *_disp, const glm::vec3 *_axes);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief World position of a point given along the axes of the grid being polygonized
+    glm::vec3 gridToWorld(const glm::vec3 &_p) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief World positions of the count grid points (i, j, kBegin) to (i, j, kBegin + count - 1), for sampleRow
+    void rowPositions(unsigned int i, unsigned int j, unsigned int kBegin, unsigned int count, float *o_x, float *o_y, float *o_z) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Where a vertex given in volume coordinates is output, see m_worldSpace
+    glm::vec3 outputPosition(const glm::vec3 &_p) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The output normal for a normal computed in volume coordinates, turned into world space along with the
+    /// vertices, or scaled like them to [-1,1] when the grid is not a cube
+    glm::vec3 outputNormal(const glm::vec3 &_n) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Use PolygonizeOctree in run() rather than the dense volume
+    bool m_octree = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Number of samples along each axis of the octree, the equivalent of the dense volume width
+    unsigned int m_octreeResolution = 1024;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Only sample the bricks near the isosurface, see PrepareNarrowBand
+    bool m_narrowBand = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Sample the dense volume and march its cells brick by brick along a Z-order (Morton) curve instead of
+    /// row by row, so consecutive sdf queries and cells stay close. The volume is the same, the triangles of
+    /// Polygonize come out in a different order. PolygonizeIndexed already sweeps one plane at a time and ignores it
+    bool m_mortonOrder = false;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief Holds the triangle normal as a vector
-    glm::vec3 m_triNormal;
+    /// @brief Edge length in voxels of the bricks used by the narrow band, the Morton order and of the octree leaves
+    unsigned int m_brickSize = 8;
     //----------------------------------------------------------------------------------------------------------------------
     /// @briaf Holds vertices of the polygonized meshes
     std::vector<float> m_verts;
@@ -111,17 +276,40 @@ public:
     /// @brief The offset value applied to the meshes
     float m_offset;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief An array of the vertices of the meshes at each offset level, used for quickly updating offset
-    std::vector<float> m_offsetArray [10][4];
+    /// @brief The vertices of the meshes at each offset level, used for quickly updating offset. Indexed by level
+    /// then by mesh, dynamic meshes first
+    std::vector<std::vector<std::vector<float>>> m_offsetArray;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief An array of the vertices normals of the meshes at each offset level, used for quickly updating offset
-    std::vector<float> m_normalOffsetArray [10][4];
+    /// @brief The vertices normals of the meshes at each offset level, used for quickly updating offset
+    std::vector<std::vector<std::vector<float>>> m_normalOffsetArray;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Polygonize shares vertices between triangles and fills m_indices instead of emitting a triangle soup
+    bool m_indexedOutput = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief PolygonizeIndexed takes the vertex normals from the gradient of the volume, interpolated along each
+    /// crossed edge, instead of averaging the face normals. Needs no extra sdf query and no second pass over the mesh
+    bool m_gradientNormals = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The triangle soup interpolates its vertices in float instead of double. The triangles are the same, the
+    /// vertices can move by a rounding step
+    bool m_singlePrecision = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Triangle indices into m_verts and m_vertsNormal, only filled when m_indexedOutput is set
+    std::vector<unsigned int> m_indices;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The indices of the meshes at each offset level, empty unless m_indexedOutput is set
+    std::vector<std::vector<std::vector<unsigned int>>> m_indexOffsetArray;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Grows the offset arrays to at least _noLevels levels
+    void addOffsetLevels(int _noLevels);
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<unsigned int> m_renderIndexArray;
     //----------------------------------------------------------------------------------------------------------------------
     std::vector<float> m_renderNormalArray;
     //----------------------------------------------------------------------------------------------------------------------
     std::vector<float> m_renderArray;
     //----------------------------------------------------------------------------------------------------------------------
-    typedef sdf::signed_distance_field_from_mesh mesh;
+    typedef SignedDistanceField mesh;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief Number of dynamic meshes initialized in the compiler
     int m_noDynamic = 0;
@@ -130,26 +318,178 @@ public:
     int m_noStatic = 0;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief Array to store the sdf value of the dynamic meshes
-    mesh m_dynObj[3];
+    std::vector<mesh> m_dynObj;
     //----------------------------------------------------------------------------------------------------------------------
      /// @brief Array to store the sdf value of the static meshes
-    mesh m_staticObj[1];
+    std::vector<mesh> m_staticObj;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Boxes of the dynamic meshes then the static ones, to find the neighbours of a sample
+    MeshBoundsTree m_meshTree;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Rebuilds m_meshTree from the meshes loaded so far
+    void updateMeshTree();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Other meshes further than this from a sample are left out of its offset blend, as if infinitely far.
+    /// Their pull on the blend falls off as 0.1/distance, so at the default leaving them out changes the offset by
+    /// about 1%. FLT_MAX blends every sample with every mesh
+    float m_neighbourRadius = 10.0f;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief Offsets each of the dynamic meshes by m_offset about the other meshes
     /// @author Kate Edge
     float offsetMesh(glm::vec3 pos, int objNo);
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The blending part of offsetMesh for count samples of dynamic mesh meshNo. Only the meshes
+    /// within m_neighbourRadius of a sample take part, found with m_meshTree, so the cost grows with the number of
+    /// neighbours rather than the size of the rig
+    /// @param [in] _current the distance to mesh meshNo at each sample
+    /// @param [in] _distances called for each neighbour with its index (dynamic meshes first, then static), the
+    /// samples it is in reach of and their count, fills their distances to it
+    /// @param [out] o_row count blended samples
+    void blendRow(const float *x, const float *y, const float *z, unsigned int count, int meshNo, const float *_current,
+                  const std::function<void(unsigned int, const unsigned int *, unsigned int, float *)> &_distances,
+                  float *o_row);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief blendRow at several offsets, _distances is still called once per neighbour
+    /// @param [out] o_rows one row of count blended samples per offset
+    void blendRows(const float *x, const float *y, const float *z, unsigned int count, int meshNo, const float *_current,
+                   const std::function<void(unsigned int, const unsigned int *, unsigned int, float *)> &_distances,
+                   const float *_offsets, unsigned int _noOffsets, float *const *o_rows);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Keep the raw sdf of every mesh over the volume after the first PrepareVolume, so later offsets only
+    /// redo the blending of offsetMesh and the marching cubes. Costs one float per voxel per mesh
+    bool m_cacheFields = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The cached raw sdf of the dynamic and static meshes, laid out like volumeData
+    std::vector<std::vector<float>> m_dynFields;
+    std::vector<std::vector<float>> m_staticFields;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The grid the cached fields were sampled on, the cache is rebuilt when it changes and after addMesh,
+    /// which clears m_fieldDims
+    unsigned int m_fieldDims[3] = {0, 0, 0};
+    float m_fieldBboxMin[3] = {0.0f, 0.0f, 0.0f};
+    float m_fieldBboxMax[3] = {0.0f, 0.0f, 0.0f};
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief With m_cacheFields, also keep each raw field in a file next to its obj (path + ".sdfcache") and map it
+    /// on later runs. The file is only used if the obj content, the grid and m_halfDiskCache are unchanged. Each file
+    /// holds one float per voxel, 13.5MB at a resolution of 150 and 108MB at 300
+    bool m_diskCache = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Write the disk cache as 16 bit halves, half the size but the meshes move by up to a thousandth of the distance.
+    /// A cache written with the other setting is sampled again and replaced
+    bool m_halfDiskCache = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The obj files given to addMesh, used to find and validate the disk cache
+    std::vector<std::string> m_dynPaths;
+    std::vector<std::string> m_staticPaths;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Samples the raw sdf of every mesh into m_dynFields and m_staticFields, if not already cached
+    void PrepareFields(const float *bbox_min, const float *bbox_max, const float *disp);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Forgets the cached fields and shared volumes, needed after replacing a mesh
+    void clearFields();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Sample the volumes of all the meshes together, see PrepareSharedVolumes. Ignored with m_cacheFields,
+    /// which also queries every mesh once, and with m_tightBounds or m_orientedBounds as the meshes have no common grid.
+    /// Costs one float per voxel per mesh
+    bool m_sharedSampling = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The volumes of the dynamic then the static meshes, laid out like volumeData
+    std::vector<std::vector<float>> m_sharedVolumes;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The grid and settings m_sharedVolumes were sampled with, they are resampled when one changes and after
+    /// addMesh, which clears m_sharedDims
+    unsigned int m_sharedDims[3] = {0, 0, 0};
+    float m_sharedBboxMin[3] = {0.0f, 0.0f, 0.0f};
+    float m_sharedBboxMax[3] = {0.0f, 0.0f, 0.0f};
+    float m_sharedOffset = 0.0f;
+    float m_sharedIsolevel = 0.0f;
+    float m_sharedNeighbourRadius = 0.0f;
+    bool m_sharedLazyOffset = false;
+    bool m_sharedGradientNormals = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Samples the volume of every mesh in a single pass over the grid. Each row queries the distance to every
+    /// mesh once and derives the blended rows of all the dynamic meshes from them, where Polygonize would query
+    /// every neighbour again for each dynamic mesh. Gives the same volumes as PrepareVolume
+    void PrepareSharedVolumes(const float *bbox_min, const float *bbox_max);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Polygonizes one mesh, with the octree if m_octree is set, and moves the result into
+    /// m_offsetArray, m_normalOffsetArray and m_indexOffsetArray at _level and _slot
+    void polygonizeInto(int _level, int _slot, int modelNo, bool _static);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Polygonizes the dynamic meshes again at a new offset into offset level _level.
+    /// Static meshes do not depend on the offset and are copied from level 0. With m_cacheFields set no sdf is sampled
+    void updateOffset(float _offset, int _level);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief updateOffset for several offsets at once, into the levels from _firstLevel on. Each dynamic mesh is
+    /// swept once, see sweepOffsets, so more levels mostly add marching cubes. Falls back to updateOffset for each level
+    /// with m_octree, m_narrowBand, m_sharedSampling or m_mortonOrder, which the sweep does not implement
+    void updateOffsets(const std::vector<float> &_offsets, int _firstLevel = 0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Polygonizes dynamic mesh meshNo at every offset in a single pass over its grid. The x planes are sampled
+    /// one at a time, the distances of each row to the meshes are queried once and blended at every offset, and the
+    /// marching cubes of every level advance over the last few planes while they are still in cache. Only four planes
+    /// per level are kept rather than a volume. The meshes are the same as polygonizeInto at each offset, with the
+    /// triangles in x slab order whatever m_mortonOrder
+    void sweepOffsets(int meshNo, const std::vector<float> &_offsets, int _firstLevel);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Sets up the grid of a mesh for streamPlanes and pipelinePlanes, like PrepareVolume
+    /// @return true when the distances come from the cached fields
+    bool planeGrid(int meshNo, bool _static);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Samples rows [_firstRow,_endRow) of x plane i at each of _noLevels offsets
+    /// @param [in] _cached take the distances from the cached fields, see planeGrid
+    /// @param [out] o_planes one plane of the grid per level, laid out like a plane of volumeData
+    void samplePlaneRows(unsigned int i, unsigned int _firstRow, unsigned int _endRow, int meshNo, bool _static,
+                         bool _cached, const float *_offsets, unsigned int _noLevels, float *const *o_planes);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The sweep of sweepOffsets and of m_streamVolume. Sets up the grid of the mesh like PrepareVolume, then
+    /// samples it one x plane at a time at each of the _noLevels offsets and extracts every level two planes behind,
+    /// from a ring of four planes per level
+    /// @param [out] o_sweeps one indexed mesh per level with m_indexedOutput, o_triangles one soup per level otherwise
+    void streamPlanes(int meshNo, bool _static, const float *_offsets, unsigned int _noLevels,
+                      std::vector<IndexedSweep> &o_sweeps, std::vector<std::vector<TRIANGLE>> &o_triangles);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief The triangle soup of a mesh at m_offset with sampling and extraction overlapped, see m_pipelined.
+    /// Sampled planes go through a BoundedQueue, the slab between two planes is extracted by the thread taking the
+    /// second of them, and finished slabs are appended to o_triangles in x order while the others are in flight
+    void pipelinePlanes(int meshNo, bool _static, std::vector<TRIANGLE> &o_triangles);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Polygonize streams the volume through streamPlanes instead of sampling it whole, so memory grows with
+    /// the area of an x plane rather than the volume and volumeData is released. The meshes are the same, with the
+    /// triangles in x slab order. Takes precedence over m_sharedSampling, m_narrowBand and m_mortonOrder, the octree
+    /// never holds a dense volume anyway
+    bool m_streamVolume = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Polygonize samples and extracts at the same time, see pipelinePlanes, instead of sampling every plane
+    /// before extracting it. Keeps a ring of planes like m_streamVolume and gives the same meshes. Indexed output
+    /// needs its planes in order and streams instead. updateOffsets pipelines a single level too, several levels
+    /// share one sweep instead
+    bool m_pipelined = false;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief Used to add a mesh to m_dynObj or m_staticObj using its file path
+    /// @return false if the mesh could not be loaded, the slot is then left empty
     /// @author Kate Edge
-    void addMesh(int _id, const char *_meshPath, bool _static);
+    bool addMesh(int _id, const char *_meshPath, bool _static);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief Calls offset and polygize functions for each mesh
     /// @author Kate Edge
     void run();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Number of threads used to sample the volume and extract the meshes, 0 uses every hardware core.
+    /// The work is split into x slabs with their own outputs so the result is identical for any thread count
+    unsigned int m_threadCount = 0;
 
     /// \brief write exports the vertices and normals into a new obj file at the specified destination,
+    /// returns false if the file could not be written
     /// @author Alberto La Scala
-    static void write(const std::vector<float> &_vertices, const std::vector<float> &_normals, std::string _destination);
+    static bool write(const std::vector<float> &_vertices, const std::vector<float> &_normals, std::string _destination);
+
+    /// \brief write exports an indexed mesh, vertices and normals share the indices
+    static bool write(const std::vector<float> &_vertices, const std::vector<float> &_normals, const std::vector<unsigned int> &_indices, std::string _destination);
+
+    /// \brief writeBinary exports a mesh as a little binary file: the characters IMSH, then the vertex and index
+    /// counts as 32 bit unsigned ints, the positions, the normals and the indices. A triangle soup has no indices
+    static bool writeBinary(const std::vector<float> &_vertices, const std::vector<float> &_normals, const std::vector<unsigned int> &_indices, std::string _destination);
 
 
 
@@ -0,0 +1,248 @@
+#include "FieldCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FIELDCACHE_MMAP
+#endif
+
+namespace
+{
+    const char c_magic[8] = {'I','M','S','D','F','\0','\0','\0'};
+    const uint32_t c_version = 1;
+
+    uint16_t floatToHalf(float _value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &_value, 4);
+
+        const uint32_t sign = (bits >> 16) & 0x8000;
+        const int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        // nan, infinity and anything too large saturate to infinity
+        if(exponent >= 31)
+            return uint16_t(sign | 0x7c00 | (((bits & 0x7f800000) == 0x7f800000 && mantissa) ? 0x200 : 0));
+
+        // subnormal halves
+        if(exponent <= 0)
+        {
+            if(exponent < -10)
+                return uint16_t(sign);
+            mantissa |= 0x800000;
+            const uint32_t shift = uint32_t(14 - exponent);
+            uint32_t half = mantissa >> shift;
+            // round to nearest even
+            const uint32_t rest = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if(rest > halfway || (rest == halfway && (half & 1)))
+                half++;
+            return uint16_t(sign | half);
+        }
+
+        uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+        const uint32_t rest = mantissa & 0x1fff;
+        if(rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+            half++; // may carry into the exponent, which is still correct
+        return uint16_t(sign | half);
+    }
+
+    float halfToFloat(uint16_t _half)
+    {
+        const uint32_t sign = uint32_t(_half & 0x8000) << 16;
+        uint32_t exponent = (_half >> 10) & 0x1f;
+        uint32_t mantissa = _half & 0x3ff;
+        uint32_t bits;
+
+        if(exponent == 0)
+        {
+            if(mantissa == 0)
+            {
+                bits = sign;
+            }
+            else
+            {
+                // normalise the subnormal
+                exponent = 127 - 15 + 1;
+                while((mantissa & 0x400) == 0)
+                {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+            }
+        }
+        else if(exponent == 31)
+        {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else
+        {
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+
+        float value;
+        std::memcpy(&value, &bits, 4);
+        return value;
+    }
+
+    bool matches(const FieldCacheHeader &_header, const FieldCacheHeader &_expected)
+    {
+        if(std::memcmp(_header.magic, c_magic, sizeof(c_magic)) != 0 || _header.version != c_version)
+            return false;
+
+        // a half cache is stale for a run asking for full precision and the other way round
+        if(_header.format > 1 || _header.format != _expected.format)
+            return false;
+
+        for(int n = 0; n < 3; n++)
+        {
+            if(_header.dims[n] != _expected.dims[n] ||
+               _header.bboxMin[n] != _expected.bboxMin[n] || _header.bboxMax[n] != _expected.bboxMax[n])
+                return false;
+        }
+
+        return _header.meshHash == _expected.meshHash;
+    }
+
+    /// @brief Checks the header at the start of _data and decodes the payload into o_field
+    bool decode(const char *_data, size_t _size, const FieldCacheHeader &_expected, std::vector<float> &o_field)
+    {
+        if(_size < sizeof(FieldCacheHeader))
+            return false;
+
+        FieldCacheHeader header;
+        std::memcpy(&header, _data, sizeof(header));
+        if(!matches(header, _expected))
+            return false;
+
+        const size_t count = size_t(header.dims[0])*header.dims[1]*header.dims[2];
+        const size_t valueSize = header.format == 1 ? 2 : 4;
+        if(_size != sizeof(FieldCacheHeader) + count*valueSize)
+            return false;
+
+        const char *payload = _data + sizeof(FieldCacheHeader);
+        o_field.resize(count);
+        if(header.format == 0)
+        {
+            std::memcpy(o_field.data(), payload, count*4);
+        }
+        else
+        {
+            for(size_t i = 0; i < count; i++)
+            {
+                uint16_t half;
+                std::memcpy(&half, payload + i*2, 2);
+                o_field[i] = halfToFloat(half);
+            }
+        }
+        return true;
+    }
+}
+
+bool hashFile(const std::string &_path, uint64_t &o_hash)
+{
+    std::ifstream file(_path, std::ios::binary);
+    if(!file)
+        return false;
+
+    uint64_t hash = 14695981039346656037ULL;
+    char buffer[1 << 16];
+    while(file)
+    {
+        file.read(buffer, sizeof(buffer));
+        const std::streamsize read = file.gcount();
+        for(std::streamsize i = 0; i < read; i++)
+        {
+            hash = (hash ^ static_cast<unsigned char>(buffer[i]))*1099511628211ULL;
+        }
+    }
+
+    o_hash = hash;
+    return true;
+}
+
+bool loadFieldCache(const std::string &_path, const FieldCacheHeader &_expected, std::vector<float> &o_field)
+{
+#ifdef FIELDCACHE_MMAP
+    const int fd = open(_path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(info.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return false;
+
+    const bool loaded = decode(static_cast<const char *>(data), size, _expected, o_field);
+    munmap(data, size);
+    return loaded;
+#else
+    std::ifstream file(_path, std::ios::binary | std::ios::ate);
+    if(!file)
+        return false;
+
+    std::vector<char> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if(!file.read(data.data(), data.size()))
+        return false;
+
+    return decode(data.data(), data.size(), _expected, o_field);
+#endif
+}
+
+bool saveFieldCache(const std::string &_path, FieldCacheHeader _header, const std::vector<float> &_field, bool _half)
+{
+    std::memcpy(_header.magic, c_magic, sizeof(c_magic));
+    _header.version = c_version;
+    _header.format = _half ? 1 : 0;
+    _header.reserved = 0;
+
+    // write to a temporary file first so an interrupted bake never leaves a truncated cache behind
+    const std::string temporary = _path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if(!file)
+            return false;
+
+        file.write(reinterpret_cast<const char *>(&_header), sizeof(_header));
+        if(_half)
+        {
+            std::vector<uint16_t> halves(_field.size());
+            for(size_t i = 0; i < _field.size(); i++)
+                halves[i] = floatToHalf(_field[i]);
+            file.write(reinterpret_cast<const char *>(halves.data()), halves.size()*2);
+        }
+        else
+        {
+            file.write(reinterpret_cast<const char *>(_field.data()), _field.size()*4);
+        }
+
+        if(!file)
+        {
+            file.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+#ifndef FIELDCACHE_MMAP
+    // rename does not replace an existing file everywhere
+    std::remove(_path.c_str());
+#endif
+    return std::rename(temporary.c_str(), _path.c_str()) == 0;
+}
@@ -23,6 +23,7 @@ GLWindow::GLWindow( QWidget *_parent ) : QOpenGLWidget( _parent )
   m_vaoFlag=false;
 
   m_outputMeshNo = 0;
+  m_offsetUI = 0.0f;
 
 }
 
@@ -46,6 +47,11 @@ void GLWindow::initializeGL()
 
   m_M = new MarchingCube(2,1);
 
+  // keep the sampled fields so changing the offset only redoes the blending
+  m_M->m_cacheFields = true;
+  // and keep them next to the models between launches
+  m_M->m_diskCache = true;
+
   // dynamic
   m_M->addMesh(1,"models/muscle1.obj", false);
   m_M->addMesh(2,"models/muscle2.obj", false);
@@ -171,6 +177,13 @@ void GLWindow::init()
   glEnableVertexAttribArray( n );
   glVertexAttribPointer( n, 3, GL_FLOAT, GL_FALSE, 0, 0 );
 
+  // indexed meshes share their vertices, load the triangles into an element buffer
+  if(m_M->m_indexedOutput)
+  {
+      glGenBuffers( 1, &m_ibo );
+      loadIndices(0);
+  }
+
   m_vaoFlag = true;
 
 
@@ -215,6 +228,57 @@ int GLWindow::boneTotalVertices()
 
 //------------------------------------------------------------------------------------------------------------------------------
 
+int GLWindow::muscleTotalIndices()
+{
+    int totalIndices = 0;
+
+    for(int i = 0; i< m_M->m_noDynamic; i++)
+    {
+        totalIndices += m_M->m_indexOffsetArray[int(m_offsetUI*5)][i].size();
+    }
+
+    return totalIndices;
+
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+
+int GLWindow::boneTotalIndices()
+{
+    int totalIndices = 0;
+
+    for(int i = m_M->m_noDynamic; i< m_M->m_noDynamic + m_M->m_noStatic; i++)
+    {
+        totalIndices += m_M->m_indexOffsetArray[int(m_offsetUI*5)][i].size();
+    }
+
+    return totalIndices;
+
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+
+void GLWindow::loadIndices(int _offsetLevel)
+{
+    m_M->m_renderIndexArray.clear();
+
+    // each mesh indexes its own vertices, shift them to where the mesh starts in m_renderArray
+    unsigned int firstVertex = 0;
+    for(int i = 0; i<m_M->m_noDynamic + m_M->m_noStatic; i++)
+    {
+        for(uint j =0; j < m_M->m_indexOffsetArray[_offsetLevel][i].size(); ++j )
+        {
+            m_M->m_renderIndexArray.push_back(firstVertex + m_M->m_indexOffsetArray[_offsetLevel][i][j]);
+        }
+        firstVertex += m_M->m_offsetArray[_offsetLevel][i].size()/3;
+    }
+
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_ibo );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, m_M->m_renderIndexArray.size() * sizeof(GLuint), m_M->m_renderIndexArray.data(), GL_STATIC_DRAW );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+
 void GLWindow::paintGL()
 {
   glViewport( 0, 0, width(), height() );
@@ -255,14 +319,20 @@ void GLWindow::renderScene()
   glUniform3fv( m_colorAddress, 1, glm::value_ptr( color ) );
 
 
-  glDrawArrays( GL_TRIANGLES, 0, muscleTotalVertices()/3 );
+  if(m_M->m_indexedOutput)
+    glDrawElements( GL_TRIANGLES, muscleTotalIndices(), GL_UNSIGNED_INT, 0 );
+  else
+    glDrawArrays( GL_TRIANGLES, 0, muscleTotalVertices()/3 );
 
   color = {242.0f/255, 232.0f/255, 213.0f/255};
 
   glUniform3fv( m_colorAddress, 1, glm::value_ptr( color ) );
 
 
-  glDrawArrays( GL_TRIANGLES, muscleTotalVertices()/3 , boneTotalVertices()/3 );
+  if(m_M->m_indexedOutput)
+    glDrawElements( GL_TRIANGLES, boneTotalIndices(), GL_UNSIGNED_INT, reinterpret_cast<void *>(muscleTotalIndices() * sizeof(GLuint)) );
+  else
+    glDrawArrays( GL_TRIANGLES, muscleTotalVertices()/3 , boneTotalVertices()/3 );
 }
 
 //------------------------------------------------------------------------------------------------------------------------------
@@ -271,6 +341,12 @@ void GLWindow::updateOffset(double _offset)
 {
     m_offsetUI = _offset;
 
+    // offset levels are polygonized the first time they are shown
+    if(m_M->m_noDynamic > 0 && m_M->m_offsetArray[int(m_offsetUI*5)][0].empty())
+    {
+        m_M->updateOffset(float(_offset), int(m_offsetUI*5));
+    }
+
     m_M->m_renderArray.clear();
     m_M->m_renderNormalArray.clear();
 
@@ -317,6 +393,11 @@ void GLWindow::updateOffset(double _offset)
     glEnableVertexAttribArray( n );
     glVertexAttribPointer( n, 3, GL_FLOAT, GL_FALSE, 0, 0 );
 
+    if(m_M->m_indexedOutput)
+    {
+        loadIndices(int(m_offsetUI*5));
+    }
+
 }
 
 void GLWindow::outputMesh()
@@ -336,7 +417,14 @@ void GLWindow::outputMesh()
         {
             outputName = "boneMesh";
         }
-        m_M->write(m_M->m_offsetArray[int(m_offsetUI*5)][i],m_M->m_normalOffsetArray[int(m_offsetUI*5)][i], outputName+"_"+std::to_string(i)+"_"+meshNo+outputFormat);
+        if(m_M->m_indexedOutput)
+        {
+            m_M->write(m_M->m_offsetArray[int(m_offsetUI*5)][i],m_M->m_normalOffsetArray[int(m_offsetUI*5)][i],m_M->m_indexOffsetArray[int(m_offsetUI*5)][i], outputName+"_"+std::to_string(i)+"_"+meshNo+outputFormat);
+        }
+        else
+        {
+            m_M->write(m_M->m_offsetArray[int(m_offsetUI*5)][i],m_M->m_normalOffsetArray[int(m_offsetUI*5)][i], outputName+"_"+std::to_string(i)+"_"+meshNo+outputFormat);
+        }
 
     }
 
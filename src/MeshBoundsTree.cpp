@@ -0,0 +1,116 @@
+#include "MeshBoundsTree.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+    // boxes per leaf, rigs have tens of meshes so the tree stays shallow
+    const unsigned int c_leafSize = 2;
+    // every split is at the median so the depth is at most 32 for 2^32 boxes, and a traversal holds at most one entry
+    // per level plus one
+    const unsigned int c_stackSize = 64;
+
+    float boxDistance2(const glm::vec3 &_min, const glm::vec3 &_max, const glm::vec3 &_qmin, const glm::vec3 &_qmax)
+    {
+        const glm::vec3 gap = glm::max(glm::max(_min - _qmax, _qmin - _max), glm::vec3(0.0f));
+        return glm::dot(gap, gap);
+    }
+}
+
+void MeshBoundsTree::build(const std::vector<glm::vec3> &_min, const std::vector<glm::vec3> &_max)
+{
+    m_min = _min;
+    m_max = _max;
+    m_nodes.clear();
+    m_order.clear();
+    for(unsigned int i = 0; i < m_min.size(); i++)
+    {
+        if(m_min[i].x <= m_max[i].x && m_min[i].y <= m_max[i].y && m_min[i].z <= m_max[i].z)
+            m_order.push_back(i);
+    }
+
+    if(!m_order.empty())
+        build(0, static_cast<unsigned int>(m_order.size()));
+}
+
+void MeshBoundsTree::build(unsigned int _first, unsigned int _count)
+{
+    const unsigned int index = static_cast<unsigned int>(m_nodes.size());
+    m_nodes.push_back(Node());
+
+    glm::vec3 bmin(FLT_MAX), bmax(-FLT_MAX);
+    glm::vec3 cmin(FLT_MAX), cmax(-FLT_MAX);
+    for(unsigned int i = _first; i < _first + _count; i++)
+    {
+        const unsigned int box = m_order[i];
+        bmin = glm::min(bmin, m_min[box]);
+        bmax = glm::max(bmax, m_max[box]);
+        const glm::vec3 centre = (m_min[box] + m_max[box])*0.5f;
+        cmin = glm::min(cmin, centre);
+        cmax = glm::max(cmax, centre);
+    }
+    m_nodes[index].bmin = bmin;
+    m_nodes[index].bmax = bmax;
+
+    if(_count <= c_leafSize)
+    {
+        m_nodes[index].offset = _first;
+        m_nodes[index].count = _count;
+        return;
+    }
+
+    const glm::vec3 extent = cmax - cmin;
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    const unsigned int half = _count/2;
+    std::nth_element(m_order.begin() + _first, m_order.begin() + _first + half, m_order.begin() + _first + _count,
+                     [&](unsigned int _a, unsigned int _b)
+    {
+        return m_min[_a][axis] + m_max[_a][axis] < m_min[_b][axis] + m_max[_b][axis];
+    });
+
+    build(_first, half);
+    m_nodes[index].offset = static_cast<unsigned int>(m_nodes.size());
+    m_nodes[index].count = 0;
+    build(_first + half, _count - half);
+}
+
+void MeshBoundsTree::query(const glm::vec3 &_min, const glm::vec3 &_max, float _radius, std::vector<unsigned int> &o_ids) const
+{
+    o_ids.clear();
+    if(m_nodes.empty())
+        return;
+
+    const float radius2 = _radius*_radius;
+    unsigned int stack[c_stackSize];
+    unsigned int top = 0;
+    stack[top++] = 0;
+    while(top > 0)
+    {
+        const unsigned int index = stack[--top];
+        const Node &node = m_nodes[index];
+        if(boxDistance2(node.bmin, node.bmax, _min, _max) > radius2)
+            continue;
+
+        if(node.count == 0)
+        {
+            stack[top++] = node.offset;
+            stack[top++] = index + 1;
+            continue;
+        }
+
+        for(unsigned int i = node.offset; i < node.offset + node.count; i++)
+        {
+            const unsigned int box = m_order[i];
+            if(boxDistance2(m_min[box], m_max[box], _min, _max) <= radius2)
+                o_ids.push_back(box);
+        }
+    }
+
+    std::sort(o_ids.begin(), o_ids.end());
+}
+
+float MeshBoundsTree::distance2(unsigned int _id, const glm::vec3 &_p) const
+{
+    return boxDistance2(m_min[_id], m_max[_id], _p, _p);
+}
@@ -0,0 +1,48 @@
+#include "OffsetBlend.h"
+
+#include <vector>
+
+void blendRowGeneric(int _noDynamic, int _noStatic, const float *const *_dynamic, const float *const *_static,
+                     unsigned int _count, float _localOffset, float *o_row)
+{
+    std::vector<float> src(_noDynamic > 0 ? _noDynamic : 1);
+    std::vector<float> sta(_noStatic > 0 ? _noStatic : 1);
+    for(unsigned int k = 0; k < _count; k++)
+    {
+        for(int i = 0; i < _noDynamic; i++)
+            src[i] = _dynamic[i][k];
+        for(int s = 0; s < _noStatic; s++)
+            sta[s] = _static[s][k];
+
+        o_row[k] = blendKernel(src.data(), _noDynamic, sta.data(), _noStatic, _localOffset);
+    }
+}
+
+BlendRowKernel selectBlendRowKernel(int _noDynamic, int _noStatic)
+{
+    // rigs of up to 4 muscles and 1 bone are specialised, anything else goes through the generic kernel
+    if(_noStatic == 0)
+    {
+        switch(_noDynamic)
+        {
+        case 1: return blendRowKernel<1, 0>;
+        case 2: return blendRowKernel<2, 0>;
+        case 3: return blendRowKernel<3, 0>;
+        case 4: return blendRowKernel<4, 0>;
+        default: break;
+        }
+    }
+    else if(_noStatic == 1)
+    {
+        switch(_noDynamic)
+        {
+        case 1: return blendRowKernel<1, 1>;
+        case 2: return blendRowKernel<2, 1>;
+        case 3: return blendRowKernel<3, 1>;
+        case 4: return blendRowKernel<4, 1>;
+        default: break;
+        }
+    }
+
+    return blendRowGeneric;
+}
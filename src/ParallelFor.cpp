@@ -0,0 +1,52 @@
+#include "ParallelFor.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+unsigned int resolveThreadCount(unsigned int _threads)
+{
+    if(_threads == 0)
+    {
+        _threads = std::thread::hardware_concurrency();
+    }
+
+    return _threads == 0 ? 1 : _threads;
+}
+
+void parallelFor(unsigned int _begin, unsigned int _end, unsigned int _threads, const std::function<void(unsigned int)> &_func)
+{
+    if(_end <= _begin)
+        return;
+
+    unsigned int noThreads = resolveThreadCount(_threads);
+    if(noThreads > _end - _begin)
+        noThreads = _end - _begin;
+
+    // no point paying for thread creation when there is nothing to share
+    if(noThreads == 1)
+    {
+        for(unsigned int i = _begin; i < _end; i++)
+            _func(i);
+        return;
+    }
+
+    std::atomic<unsigned int> next(_begin);
+
+    auto worker = [&]()
+    {
+        for(unsigned int i = next++; i < _end; i = next++)
+            _func(i);
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(noThreads - 1);
+    for(unsigned int t = 1; t < noThreads; t++)
+        pool.emplace_back(worker);
+
+    // the calling thread works too
+    worker();
+
+    for(auto &thread : pool)
+        thread.join();
+}
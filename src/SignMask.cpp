@@ -0,0 +1,91 @@
+#include "SignMask.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+#if defined(__AVX__)
+    /// @brief Eight samples per compare
+    struct Lanes
+    {
+        static const unsigned int c_width = 8;
+        typedef __m256 Value;
+        static Value load(const float *_p) { return _mm256_loadu_ps(_p); }
+        static Value splat(float _v) { return _mm256_set1_ps(_v); }
+        static unsigned int less(Value _a, Value _b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(_a, _b, _CMP_LT_OQ))); }
+    };
+#elif defined(__SSE2__) || defined(_M_X64)
+    /// @brief Four samples per compare
+    struct Lanes
+    {
+        static const unsigned int c_width = 4;
+        typedef __m128 Value;
+        static Value load(const float *_p) { return _mm_loadu_ps(_p); }
+        static Value splat(float _v) { return _mm_set1_ps(_v); }
+        static unsigned int less(Value _a, Value _b) { return unsigned(_mm_movemask_ps(_mm_cmplt_ps(_a, _b))); }
+    };
+#else
+    /// @brief One sample per compare
+    struct Lanes
+    {
+        static const unsigned int c_width = 1;
+        typedef float Value;
+        static Value load(const float *_p) { return *_p; }
+        static Value splat(float _v) { return _v; }
+        static unsigned int less(Value _a, Value _b) { return _a < _b ? 1u : 0u; }
+    };
+#endif
+}
+
+void signMaskRow(const float *_values, unsigned int _count, float _isolevel, uint64_t *o_bits)
+{
+    const Lanes::Value iso = Lanes::splat(_isolevel);
+    for(unsigned int w = 0; w < signMaskWords(_count); w++)
+    {
+        const unsigned int first = w*64;
+        const unsigned int end = first + 64 < _count ? first + 64 : _count;
+        uint64_t bits = 0;
+        unsigned int k = first;
+        // c_width divides 64, so the packets never straddle two words
+        for(; k + Lanes::c_width <= end; k += Lanes::c_width)
+            bits |= static_cast<uint64_t>(Lanes::less(Lanes::load(_values + k), iso)) << (k - first);
+        for(; k < end; k++)
+            bits |= static_cast<uint64_t>(_values[k] < _isolevel) << (k - first);
+        o_bits[w] = bits;
+    }
+}
+
+bool activeCells(const uint64_t *const *_rows, unsigned int _count, uint64_t *o_active)
+{
+    const unsigned int noWords = signMaskWords(_count);
+    uint64_t any = 0;
+    for(unsigned int w = 0; w < noWords; w++)
+    {
+        // samples of the four rows that are all inside, and that are inside in any row
+        const uint64_t all = _rows[0][w] & _rows[1][w] & _rows[2][w] & _rows[3][w];
+        const uint64_t some = _rows[0][w] | _rows[1][w] | _rows[2][w] | _rows[3][w];
+        uint64_t nextAll = 0, nextSome = 0;
+        if(w + 1 < noWords)
+        {
+            nextAll = _rows[0][w+1] & _rows[1][w+1] & _rows[2][w+1] & _rows[3][w+1];
+            nextSome = _rows[0][w+1] | _rows[1][w+1] | _rows[2][w+1] | _rows[3][w+1];
+        }
+
+        // cell k pairs sample k with sample k+1, it is crossed unless its eight corners are all inside or all outside
+        const uint64_t cellAll = all & ((all >> 1) | (nextAll << 63));
+        const uint64_t cellSome = some | (some >> 1) | (nextSome << 63);
+        uint64_t active = cellSome & ~cellAll;
+
+        // there are only _count-1 cells
+        const unsigned int last = _count - 1 - w*64;
+        if(last < 64)
+            active &= (uint64_t(1) << last) - 1;
+        o_active[w] = active;
+        any |= active;
+    }
+    return any != 0;
+}
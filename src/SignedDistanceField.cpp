@@ -0,0 +1,949 @@
+#include "SignedDistanceField.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    /// @brief Maximum number of triangles in a leaf
+    const unsigned int c_maxLeafSize = 4;
+    /// @brief Number of bins used to evaluate the surface area heuristic
+    const unsigned int c_noBins = 12;
+    /// @brief Deepest traversal stack, see c_maxSahDepth
+    const unsigned int c_stackSize = 64;
+    /// @brief Depth past which build only splits at the median. The surface area heuristic can peel a single triangle
+    /// off a node, so on skewed meshes it has no depth bound. Median splits add at most 30 levels for 2^32 triangles,
+    /// and a traversal holds at most one entry per level plus one, so the stacks cannot overflow
+    const unsigned int c_maxSahDepth = 32;
+    static_assert(c_maxSahDepth + 31 < c_stackSize, "median splits past c_maxSahDepth must fit the traversal stack");
+
+    struct Bounds
+    {
+        glm::vec3 lo = glm::vec3(FLT_MAX);
+        glm::vec3 hi = glm::vec3(-FLT_MAX);
+
+        void grow(const glm::vec3 &_p) { lo = glm::min(lo, _p); hi = glm::max(hi, _p); }
+        void grow(const Bounds &_b) { lo = glm::min(lo, _b.lo); hi = glm::max(hi, _b.hi); }
+        float area() const
+        {
+            if(lo.x > hi.x)
+                return 0.0f;
+            glm::vec3 e = hi - lo;
+            return e.x*e.y + e.y*e.z + e.z*e.x;
+        }
+    };
+
+#if defined(__AVX__)
+    /// @brief Eight points per packet
+    struct Lanes
+    {
+        static const unsigned int c_width = 8;
+        typedef __m256 Value;
+        static Value load(const float *_p) { return _mm256_loadu_ps(_p); }
+        static Value splat(float _v) { return _mm256_set1_ps(_v); }
+        static Value sub(Value _a, Value _b) { return _mm256_sub_ps(_a, _b); }
+        static Value max(Value _a, Value _b) { return _mm256_max_ps(_a, _b); }
+        static Value madd(Value _a, Value _b, Value _c) { return _mm256_add_ps(_mm256_mul_ps(_a, _b), _c); }
+        static unsigned int less(Value _a, Value _b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(_a, _b, _CMP_LT_OQ))); }
+        static void store(float *_p, Value _v) { _mm256_storeu_ps(_p, _v); }
+    };
+#elif defined(__SSE2__) || defined(_M_X64)
+    /// @brief Four points per packet
+    struct Lanes
+    {
+        static const unsigned int c_width = 4;
+        typedef __m128 Value;
+        static Value load(const float *_p) { return _mm_loadu_ps(_p); }
+        static Value splat(float _v) { return _mm_set1_ps(_v); }
+        static Value sub(Value _a, Value _b) { return _mm_sub_ps(_a, _b); }
+        static Value max(Value _a, Value _b) { return _mm_max_ps(_a, _b); }
+        static Value madd(Value _a, Value _b, Value _c) { return _mm_add_ps(_mm_mul_ps(_a, _b), _c); }
+        static unsigned int less(Value _a, Value _b) { return unsigned(_mm_movemask_ps(_mm_cmplt_ps(_a, _b))); }
+        static void store(float *_p, Value _v) { _mm_storeu_ps(_p, _v); }
+    };
+#else
+    /// @brief One point per packet, batch_query then behaves like a loop over operator()
+    struct Lanes
+    {
+        static const unsigned int c_width = 1;
+        typedef float Value;
+        static Value load(const float *_p) { return *_p; }
+        static Value splat(float _v) { return _v; }
+        static Value sub(Value _a, Value _b) { return _a - _b; }
+        static Value max(Value _a, Value _b) { return std::max(_a, _b); }
+        static Value madd(Value _a, Value _b, Value _c) { return _a*_b + _c; }
+        static unsigned int less(Value _a, Value _b) { return _a < _b ? 1u : 0u; }
+        static void store(float *_p, Value _v) { *_p = _v; }
+    };
+#endif
+
+    /// @brief Squared distance from each point of a packet to a box, 0 inside
+    template <typename L>
+    typename L::Value packetBoxDistance2(typename L::Value _x, typename L::Value _y, typename L::Value _z,
+                                         const float *_bmin, const float *_bmax)
+    {
+        const typename L::Value zero = L::splat(0.0f);
+        typename L::Value dx = L::max(L::max(L::sub(L::splat(_bmin[0]), _x), L::sub(_x, L::splat(_bmax[0]))), zero);
+        typename L::Value dy = L::max(L::max(L::sub(L::splat(_bmin[1]), _y), L::sub(_y, L::splat(_bmax[1]))), zero);
+        typename L::Value dz = L::max(L::max(L::sub(L::splat(_bmin[2]), _z), L::sub(_z, L::splat(_bmax[2]))), zero);
+        return L::madd(dx, dx, L::madd(dy, dy, L::madd(dz, dz, zero)));
+    }
+
+    /// @brief Angle of the triangle corner _a
+    float cornerAngle(const glm::vec3 &_a, const glm::vec3 &_b, const glm::vec3 &_c)
+    {
+        glm::vec3 u = glm::normalize(_b - _a);
+        glm::vec3 v = glm::normalize(_c - _a);
+        return std::acos(glm::clamp(glm::dot(u, v), -1.0f, 1.0f));
+    }
+
+    /// @brief Eigenvectors of a symmetric 3x3 matrix by cyclic Jacobi rotations, sorted by increasing eigenvalue
+    void symmetricEigenvectors(double _m[3][3], glm::dvec3 o_vectors[3])
+    {
+        double v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        for(int sweep = 0; sweep < 50; sweep++)
+        {
+            const double offDiagonal = _m[0][1]*_m[0][1] + _m[0][2]*_m[0][2] + _m[1][2]*_m[1][2];
+            if(offDiagonal < 1e-30)
+                break;
+
+            for(int p = 0; p < 2; p++)
+            {
+                for(int q = p + 1; q < 3; q++)
+                {
+                    if(_m[p][q] == 0.0)
+                        continue;
+                    // rotation zeroing _m[p][q], Numerical Recipes 11.1
+                    const double theta = (_m[q][q] - _m[p][p])/(2.0*_m[p][q]);
+                    const double t = (theta >= 0.0 ? 1.0 : -1.0)/(std::fabs(theta) + std::sqrt(theta*theta + 1.0));
+                    const double c = 1.0/std::sqrt(t*t + 1.0);
+                    const double s = t*c;
+                    for(int k = 0; k < 3; k++)
+                    {
+                        const double kp = _m[k][p], kq = _m[k][q];
+                        _m[k][p] = c*kp - s*kq;
+                        _m[k][q] = s*kp + c*kq;
+                    }
+                    for(int k = 0; k < 3; k++)
+                    {
+                        const double pk = _m[p][k], qk = _m[q][k];
+                        _m[p][k] = c*pk - s*qk;
+                        _m[q][k] = s*pk + c*qk;
+                    }
+                    for(int k = 0; k < 3; k++)
+                    {
+                        const double kp = v[k][p], kq = v[k][q];
+                        v[k][p] = c*kp - s*kq;
+                        v[k][q] = s*kp + c*kq;
+                    }
+                }
+            }
+        }
+
+        int order[3] = {0, 1, 2};
+        std::sort(order, order + 3, [&](int _a, int _b) { return _m[_a][_a] < _m[_b][_b]; });
+        for(int e = 0; e < 3; e++)
+            o_vectors[e] = glm::dvec3(v[0][order[e]], v[1][order[e]], v[2][order[e]]);
+    }
+}
+
+SignedDistanceField::SignedDistanceField()
+{
+    m_min[0] = m_min[1] = m_min[2] = FLT_MAX;
+    m_max[0] = m_max[1] = m_max[2] = -FLT_MAX;
+}
+
+SignedDistanceField::SignedDistanceField(const std::string &_filename) : SignedDistanceField()
+{
+    load_from_file(_filename);
+}
+
+bool SignedDistanceField::load_from_file(const std::string &_filename)
+{
+    std::ifstream in(_filename);
+    if(!in.is_open())
+        return false;
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<long> face;
+    std::string line, token;
+
+    while(std::getline(in, line))
+    {
+        if(line.size() < 2)
+            continue;
+
+        if(line[0] == 'v' && line[1] == ' ')
+        {
+            std::istringstream s(line.substr(2));
+            float x = 0, y = 0, z = 0;
+            s >> x >> y >> z;
+            vertices.push_back(x);
+            vertices.push_back(y);
+            vertices.push_back(z);
+        }
+        else if(line[0] == 'f' && line[1] == ' ')
+        {
+            // each corner is v, v/vt, v//vn or v/vt/vn, negative indices count back from the last vertex
+            std::istringstream s(line.substr(2));
+            face.clear();
+            while(s >> token)
+            {
+                long id = std::strtol(token.c_str(), nullptr, 10);
+                if(id < 0)
+                    id += static_cast<long>(vertices.size()/3);
+                else
+                    id -= 1;
+                face.push_back(id);
+            }
+
+            for(size_t i = 2; i < face.size(); i++)
+            {
+                indices.push_back(static_cast<unsigned int>(face[0]));
+                indices.push_back(static_cast<unsigned int>(face[i-1]));
+                indices.push_back(static_cast<unsigned int>(face[i]));
+            }
+        }
+    }
+
+    if(vertices.empty())
+        return false;
+
+    return load_from_data(indices.data(), indices.size(), vertices.data(), vertices.size()/3);
+}
+
+bool SignedDistanceField::load_from_data(const unsigned int *_indices, unsigned int _nindices,
+                                         const float *_vertices, unsigned int _nvertices, unsigned int _vertexStride)
+{
+    m_nodes.clear();
+    m_triangles.clear();
+    m_normals.clear();
+
+    // weld duplicated positions so that edges and corners are shared between faces
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> weld(_nvertices);
+    std::map<std::tuple<float, float, float>, unsigned int> unique;
+    const char *bytes = reinterpret_cast<const char *>(_vertices);
+    for(unsigned int i = 0; i < _nvertices; i++)
+    {
+        const float *v = reinterpret_cast<const float *>(bytes + size_t(i)*_vertexStride);
+        auto it = unique.insert(std::make_pair(std::make_tuple(v[0], v[1], v[2]), static_cast<unsigned int>(positions.size())));
+        if(it.second)
+            positions.push_back(glm::vec3(v[0], v[1], v[2]));
+        weld[i] = it.first->second;
+    }
+
+    std::vector<unsigned int> corners;
+    for(unsigned int i = 0; i + 2 < _nindices; i += 3)
+    {
+        if(_indices[i] >= _nvertices || _indices[i+1] >= _nvertices || _indices[i+2] >= _nvertices)
+            continue;
+        unsigned int a = weld[_indices[i]], b = weld[_indices[i+1]], c = weld[_indices[i+2]];
+        // degenerate triangles have no normal to sign with, their edges are covered by the neighbours
+        glm::vec3 n = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+        if(a == b || b == c || c == a || glm::dot(n, n) == 0.0f)
+            continue;
+        corners.push_back(a);
+        corners.push_back(b);
+        corners.push_back(c);
+    }
+
+    const unsigned int noTriangles = corners.size()/3;
+    if(noTriangles == 0)
+        return false;
+
+    // angle weighted vertex normals and summed edge normals (Baerentzen and Aanaes)
+    std::vector<glm::vec3> faceNormals(noTriangles);
+    std::vector<glm::vec3> vertexNormals(positions.size(), glm::vec3(0.0f));
+    std::map<std::pair<unsigned int, unsigned int>, glm::vec3> edgeNormals;
+    for(unsigned int t = 0; t < noTriangles; t++)
+    {
+        const unsigned int *id = &corners[t*3];
+        const glm::vec3 &a = positions[id[0]], &b = positions[id[1]], &c = positions[id[2]];
+        glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
+        faceNormals[t] = n;
+        vertexNormals[id[0]] += cornerAngle(a, b, c)*n;
+        vertexNormals[id[1]] += cornerAngle(b, c, a)*n;
+        vertexNormals[id[2]] += cornerAngle(c, a, b)*n;
+        for(int e = 0; e < 3; e++)
+        {
+            unsigned int v0 = id[e], v1 = id[(e+1)%3];
+            edgeNormals[std::make_pair(std::min(v0, v1), std::max(v0, v1))] += n;
+        }
+    }
+
+    std::vector<PseudoNormals> normals(noTriangles);
+    m_triangles.resize(noTriangles);
+    std::vector<glm::vec3> centroids(noTriangles);
+    std::vector<unsigned int> order(noTriangles);
+    for(unsigned int t = 0; t < noTriangles; t++)
+    {
+        const unsigned int *id = &corners[t*3];
+        m_triangles[t].a = positions[id[0]];
+        m_triangles[t].b = positions[id[1]];
+        m_triangles[t].c = positions[id[2]];
+        centroids[t] = (m_triangles[t].a + m_triangles[t].b + m_triangles[t].c)/3.0f;
+        order[t] = t;
+
+        normals[t].face = faceNormals[t];
+        for(int e = 0; e < 3; e++)
+        {
+            unsigned int v0 = id[e], v1 = id[(e+1)%3];
+            normals[t].edge[e] = edgeNormals[std::make_pair(std::min(v0, v1), std::max(v0, v1))];
+            normals[t].vertex[e] = vertexNormals[id[e]];
+        }
+    }
+
+    m_nodes.reserve(2*noTriangles/c_maxLeafSize + 1);
+    build(0, noTriangles, 0, centroids, order);
+
+    // pseudo-normals follow the triangles into leaf order
+    m_normals.resize(noTriangles);
+    for(unsigned int t = 0; t < noTriangles; t++)
+        m_normals[t] = normals[order[t]];
+
+    for(int i = 0; i < 3; i++)
+    {
+        m_min[i] = m_nodes[0].bmin[i];
+        m_max[i] = m_nodes[0].bmax[i];
+    }
+
+    // principal axes of the vertices used by the triangles
+    std::vector<bool> used(positions.size(), false);
+    for(unsigned int id : corners)
+        used[id] = true;
+    glm::dvec3 mean(0.0);
+    unsigned int noUsed = 0;
+    for(size_t v = 0; v < positions.size(); v++)
+    {
+        if(used[v])
+        {
+            mean += glm::dvec3(positions[v]);
+            noUsed++;
+        }
+    }
+    mean /= double(noUsed);
+    double covariance[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    for(size_t v = 0; v < positions.size(); v++)
+    {
+        if(!used[v])
+            continue;
+        const glm::dvec3 d = glm::dvec3(positions[v]) - mean;
+        for(int r = 0; r < 3; r++)
+            for(int c = 0; c < 3; c++)
+                covariance[r][c] += d[r]*d[c];
+    }
+    glm::dvec3 axes[3];
+    symmetricEigenvectors(covariance, axes);
+    // right handed, so a grid in this frame keeps the winding of its triangles
+    m_axes[0] = glm::normalize(glm::vec3(axes[0]));
+    m_axes[1] = glm::normalize(glm::vec3(axes[1]));
+    m_axes[2] = glm::normalize(glm::cross(m_axes[0], m_axes[1]));
+    m_orientedMin = glm::vec3(FLT_MAX);
+    m_orientedMax = glm::vec3(-FLT_MAX);
+    for(size_t v = 0; v < positions.size(); v++)
+    {
+        if(!used[v])
+            continue;
+        const glm::vec3 local(glm::dot(positions[v], m_axes[0]), glm::dot(positions[v], m_axes[1]), glm::dot(positions[v], m_axes[2]));
+        m_orientedMin = glm::min(m_orientedMin, local);
+        m_orientedMax = glm::max(m_orientedMax, local);
+    }
+
+    return true;
+}
+
+void SignedDistanceField::build(unsigned int _first, unsigned int _count, unsigned int _depth,
+                                std::vector<glm::vec3> &io_centroids, std::vector<unsigned int> &io_order)
+{
+    const unsigned int nodeId = m_nodes.size();
+    m_nodes.push_back(Node());
+
+    Bounds box, centroidBox;
+    for(unsigned int i = _first; i < _first + _count; i++)
+    {
+        box.grow(m_triangles[i].a);
+        box.grow(m_triangles[i].b);
+        box.grow(m_triangles[i].c);
+        centroidBox.grow(io_centroids[i]);
+    }
+    for(int i = 0; i < 3; i++)
+    {
+        m_nodes[nodeId].bmin[i] = box.lo[i];
+        m_nodes[nodeId].bmax[i] = box.hi[i];
+    }
+
+    // find the cheapest binned split over all three axes
+    int bestAxis = -1;
+    unsigned int bestBin = 0;
+    float bestCost = FLT_MAX;
+    if(_count > c_maxLeafSize && _depth >= c_maxSahDepth)
+    {
+        // coinciding centroids stay in a leaf, like when no binned split exists
+        const glm::vec3 extent = centroidBox.hi - centroidBox.lo;
+        if(extent.x > 0.0f || extent.y > 0.0f || extent.z > 0.0f)
+        {
+            splitAtMedian(_first, _count, extent, io_centroids, io_order);
+            const unsigned int mid = _first + _count/2;
+            m_nodes[nodeId].count = 0;
+            build(_first, mid - _first, _depth + 1, io_centroids, io_order);
+            m_nodes[nodeId].offset = m_nodes.size();
+            build(mid, _first + _count - mid, _depth + 1, io_centroids, io_order);
+            return;
+        }
+    }
+    else if(_count > c_maxLeafSize)
+    {
+        for(int axis = 0; axis < 3; axis++)
+        {
+            float lo = centroidBox.lo[axis], extent = centroidBox.hi[axis] - lo;
+            if(extent <= 0.0f)
+                continue;
+
+            Bounds bins[c_noBins];
+            unsigned int counts[c_noBins] = {0};
+            for(unsigned int i = _first; i < _first + _count; i++)
+            {
+                unsigned int b = std::min(c_noBins - 1, static_cast<unsigned int>((io_centroids[i][axis] - lo)/extent*c_noBins));
+                counts[b]++;
+                bins[b].grow(m_triangles[i].a);
+                bins[b].grow(m_triangles[i].b);
+                bins[b].grow(m_triangles[i].c);
+            }
+
+            // sweep from the right to get the area of every right hand side
+            float rightArea[c_noBins];
+            unsigned int rightCount[c_noBins];
+            Bounds right;
+            unsigned int n = 0;
+            for(unsigned int b = c_noBins - 1; b > 0; b--)
+            {
+                right.grow(bins[b]);
+                n += counts[b];
+                rightArea[b] = right.area();
+                rightCount[b] = n;
+            }
+
+            Bounds left;
+            n = 0;
+            for(unsigned int b = 1; b < c_noBins; b++)
+            {
+                left.grow(bins[b-1]);
+                n += counts[b-1];
+                float cost = left.area()*n + rightArea[b]*rightCount[b];
+                if(n > 0 && rightCount[b] > 0 && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+    }
+
+    if(bestAxis < 0)
+    {
+        m_nodes[nodeId].offset = _first;
+        m_nodes[nodeId].count = _count;
+        return;
+    }
+
+    // partition the triangles (with their centroids and original ids) around the chosen bin
+    float lo = centroidBox.lo[bestAxis], extent = centroidBox.hi[bestAxis] - lo;
+    unsigned int mid = _first;
+    for(unsigned int i = _first; i < _first + _count; i++)
+    {
+        unsigned int b = std::min(c_noBins - 1, static_cast<unsigned int>((io_centroids[i][bestAxis] - lo)/extent*c_noBins));
+        if(b < bestBin)
+        {
+            std::swap(m_triangles[i], m_triangles[mid]);
+            std::swap(io_centroids[i], io_centroids[mid]);
+            std::swap(io_order[i], io_order[mid]);
+            mid++;
+        }
+    }
+
+    m_nodes[nodeId].count = 0;
+    build(_first, mid - _first, _depth + 1, io_centroids, io_order);
+    m_nodes[nodeId].offset = m_nodes.size();
+    build(mid, _first + _count - mid, _depth + 1, io_centroids, io_order);
+}
+
+void SignedDistanceField::splitAtMedian(unsigned int _first, unsigned int _count, const glm::vec3 &_extent,
+                                        std::vector<glm::vec3> &io_centroids, std::vector<unsigned int> &io_order)
+{
+    const int axis = _extent.x >= _extent.y && _extent.x >= _extent.z ? 0 : (_extent.y >= _extent.z ? 1 : 2);
+    if(_extent[axis] <= 0.0f)
+        return;
+
+    std::vector<unsigned int> slots(_count);
+    for(unsigned int i = 0; i < _count; i++)
+        slots[i] = _first + i;
+    std::nth_element(slots.begin(), slots.begin() + _count/2, slots.end(), [&](unsigned int _a, unsigned int _b)
+    {
+        return io_centroids[_a][axis] < io_centroids[_b][axis];
+    });
+
+    // apply the order to the triangles, their centroids and original ids together
+    std::vector<Triangle> triangles(_count);
+    std::vector<glm::vec3> centroids(_count);
+    std::vector<unsigned int> order(_count);
+    for(unsigned int i = 0; i < _count; i++)
+    {
+        triangles[i] = m_triangles[slots[i]];
+        centroids[i] = io_centroids[slots[i]];
+        order[i] = io_order[slots[i]];
+    }
+    std::copy(triangles.begin(), triangles.end(), m_triangles.begin() + _first);
+    std::copy(centroids.begin(), centroids.end(), io_centroids.begin() + _first);
+    std::copy(order.begin(), order.end(), io_order.begin() + _first);
+}
+
+bool SignedDistanceField::is_valid() const
+{
+    return !m_nodes.empty();
+}
+
+const float *SignedDistanceField::minimum_bound() const
+{
+    return m_min;
+}
+
+const float *SignedDistanceField::maximum_bound() const
+{
+    return m_max;
+}
+
+void SignedDistanceField::oriented_bounds(glm::vec3 *o_axes, glm::vec3 &o_min, glm::vec3 &o_max) const
+{
+    for(int i = 0; i < 3; i++)
+        o_axes[i] = m_axes[i];
+    o_min = m_orientedMin;
+    o_max = m_orientedMax;
+}
+
+float SignedDistanceField::boxDistance2(const glm::vec3 &_p, const Node &_node)
+{
+    float dx = std::max(std::max(_node.bmin[0] - _p.x, _p.x - _node.bmax[0]), 0.0f);
+    float dy = std::max(std::max(_node.bmin[1] - _p.y, _p.y - _node.bmax[1]), 0.0f);
+    float dz = std::max(std::max(_node.bmin[2] - _p.z, _p.z - _node.bmax[2]), 0.0f);
+    return dx*dx + dy*dy + dz*dz;
+}
+
+glm::vec3 SignedDistanceField::closestPointOnTriangle(const glm::vec3 &_p, const Triangle &_t, Feature &o_feature)
+{
+    glm::vec3 ab = _t.b - _t.a;
+    glm::vec3 ac = _t.c - _t.a;
+    glm::vec3 ap = _p - _t.a;
+    float d1 = glm::dot(ab, ap);
+    float d2 = glm::dot(ac, ap);
+    if(d1 <= 0.0f && d2 <= 0.0f)
+    {
+        o_feature = VERTEX_A;
+        return _t.a;
+    }
+
+    glm::vec3 bp = _p - _t.b;
+    float d3 = glm::dot(ab, bp);
+    float d4 = glm::dot(ac, bp);
+    if(d3 >= 0.0f && d4 <= d3)
+    {
+        o_feature = VERTEX_B;
+        return _t.b;
+    }
+
+    float vc = d1*d4 - d3*d2;
+    if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        o_feature = EDGE_AB;
+        return _t.a + (d1/(d1 - d3))*ab;
+    }
+
+    glm::vec3 cp = _p - _t.c;
+    float d5 = glm::dot(ab, cp);
+    float d6 = glm::dot(ac, cp);
+    if(d6 >= 0.0f && d5 <= d6)
+    {
+        o_feature = VERTEX_C;
+        return _t.c;
+    }
+
+    float vb = d5*d2 - d1*d6;
+    if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        o_feature = EDGE_CA;
+        return _t.a + (d2/(d2 - d6))*ac;
+    }
+
+    float va = d3*d6 - d5*d4;
+    if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+        o_feature = EDGE_BC;
+        return _t.b + ((d4 - d3)/((d4 - d3) + (d5 - d6)))*(_t.c - _t.b);
+    }
+
+    o_feature = FACE;
+    float denom = 1.0f/(va + vb + vc);
+    return _t.a + ab*(vb*denom) + ac*(vc*denom);
+}
+
+bool SignedDistanceField::closest(const glm::vec3 &_p, float &io_dist2, unsigned int &o_triangle, glm::vec3 &o_closest, Feature &o_feature,
+                                  QueryStats *io_stats) const
+{
+    unsigned int nodes = 0, triangles = 0;
+
+    struct Entry { unsigned int node; float dist2; };
+    Entry stack[c_stackSize];
+    unsigned int top = 0;
+    bool found = false;
+
+    float rootDist2 = boxDistance2(_p, m_nodes[0]);
+    if(rootDist2 < io_dist2)
+        stack[top++] = {0, rootDist2};
+
+    while(top > 0)
+    {
+        const Entry entry = stack[--top];
+        // the radius may have shrunk since this node was pushed
+        if(entry.dist2 >= io_dist2)
+            continue;
+
+        const Node &node = m_nodes[entry.node];
+        nodes++;
+        if(node.count > 0)
+        {
+            triangles += node.count;
+            for(unsigned int t = node.offset; t < node.offset + node.count; t++)
+            {
+                Feature feature;
+                glm::vec3 q = closestPointOnTriangle(_p, m_triangles[t], feature);
+                glm::vec3 d = _p - q;
+                float dist2 = glm::dot(d, d);
+                if(dist2 < io_dist2)
+                {
+                    io_dist2 = dist2;
+                    o_triangle = t;
+                    o_closest = q;
+                    o_feature = feature;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        // push the far child first so the near one is visited next and shrinks the radius early
+        unsigned int left = entry.node + 1, right = node.offset;
+        float leftDist2 = boxDistance2(_p, m_nodes[left]);
+        float rightDist2 = boxDistance2(_p, m_nodes[right]);
+        if(leftDist2 > rightDist2)
+        {
+            std::swap(left, right);
+            std::swap(leftDist2, rightDist2);
+        }
+        if(rightDist2 < io_dist2)
+            stack[top++] = {right, rightDist2};
+        if(leftDist2 < io_dist2)
+            stack[top++] = {left, leftDist2};
+    }
+
+    if(io_stats)
+    {
+        io_stats->queries++;
+        io_stats->nodes += nodes;
+        io_stats->triangles += triangles;
+    }
+    return found;
+}
+
+template <typename L>
+void SignedDistanceField::closestPacket(const float *_x, const float *_y, const float *_z, float _maxDist2, float *o_sdf, unsigned int *io_triangles, QueryStats &io_stats) const
+{
+    const unsigned int width = L::c_width;
+    const typename L::Value x = L::load(_x), y = L::load(_y), z = L::load(_z);
+
+    float best[width];
+    unsigned int triangle[width];
+    glm::vec3 closestPoint[width];
+    Feature feature[width];
+    unsigned int nodes = 0, triangles = 0;
+
+    // Seed every point with its own triangle in the previous packet and with the one of the last point,
+    // which is the nearest to this packet. Only strictly closer triangles are taken afterwards
+    const unsigned int last = io_triangles[width-1];
+    for(unsigned int l = 0; l < width; l++)
+    {
+        best[l] = _maxDist2;
+        triangle[l] = c_noHint;
+        feature[l] = FACE;
+
+        const glm::vec3 p(_x[l], _y[l], _z[l]);
+        const unsigned int candidates[2] = {io_triangles[l], last};
+        for(unsigned int c = 0; c < 2; c++)
+        {
+            const unsigned int t = candidates[c];
+            if(t >= m_triangles.size() || (c == 1 && t == candidates[0]))
+                continue;
+
+            Feature f;
+            glm::vec3 q = closestPointOnTriangle(p, m_triangles[t], f);
+            glm::vec3 d = p - q;
+            float dist2 = glm::dot(d, d);
+            triangles++;
+            if(dist2 < best[l])
+            {
+                best[l] = dist2;
+                triangle[l] = t;
+                closestPoint[l] = q;
+                feature[l] = f;
+            }
+        }
+    }
+
+    unsigned int stack[c_stackSize];
+    unsigned int top = 0;
+    stack[top++] = 0;
+
+    while(top > 0)
+    {
+        const unsigned int index = stack[--top];
+        const Node &node = m_nodes[index];
+        const unsigned int active = L::less(packetBoxDistance2<L>(x, y, z, node.bmin, node.bmax), L::load(best));
+        if(active == 0)
+            continue;
+
+        nodes++;
+        if(node.count > 0)
+        {
+            for(unsigned int t = node.offset; t < node.offset + node.count; t++)
+            {
+                for(unsigned int l = 0; l < width; l++)
+                {
+                    if(!(active & (1u << l)))
+                        continue;
+
+                    triangles++;
+
+                    const glm::vec3 p(_x[l], _y[l], _z[l]);
+                    Feature f;
+                    glm::vec3 q = closestPointOnTriangle(p, m_triangles[t], f);
+                    glm::vec3 d = p - q;
+                    float dist2 = glm::dot(d, d);
+                    if(dist2 < best[l])
+                    {
+                        best[l] = dist2;
+                        triangle[l] = t;
+                        closestPoint[l] = q;
+                        feature[l] = f;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // the child nearer to most of the packet is visited first
+        const unsigned int left = index + 1, right = node.offset;
+        const typename L::Value bestValue = L::load(best);
+        const typename L::Value leftDist2 = packetBoxDistance2<L>(x, y, z, m_nodes[left].bmin, m_nodes[left].bmax);
+        const typename L::Value rightDist2 = packetBoxDistance2<L>(x, y, z, m_nodes[right].bmin, m_nodes[right].bmax);
+        const unsigned int leftActive = L::less(leftDist2, bestValue);
+        const unsigned int rightActive = L::less(rightDist2, bestValue);
+        const unsigned int rightNearer = L::less(rightDist2, leftDist2) & active;
+
+        unsigned int rightCount = 0, activeCount = 0;
+        for(unsigned int l = 0; l < width; l++)
+        {
+            rightCount += (rightNearer >> l) & 1u;
+            activeCount += (active >> l) & 1u;
+        }
+        const bool rightFirst = 2*rightCount > activeCount;
+
+        const unsigned int nearNode = rightFirst ? right : left, farNode = rightFirst ? left : right;
+        const unsigned int nearActive = rightFirst ? rightActive : leftActive, farActive = rightFirst ? leftActive : rightActive;
+        if(farActive)
+            stack[top++] = farNode;
+        if(nearActive)
+            stack[top++] = nearNode;
+    }
+
+    for(unsigned int l = 0; l < width; l++)
+    {
+        // points with nothing within the radius keep their hint for the next packet
+        if(triangle[l] == c_noHint)
+        {
+            o_sdf[l] = FLT_MAX;
+            continue;
+        }
+        o_sdf[l] = signedDistance(glm::vec3(_x[l], _y[l], _z[l]), best[l], triangle[l], closestPoint[l], feature[l]);
+        io_triangles[l] = triangle[l];
+    }
+
+    io_stats.queries += width;
+    io_stats.nodes += nodes;
+    io_stats.triangles += triangles;
+}
+
+const unsigned int SignedDistanceField::c_packetSize = Lanes::c_width;
+const unsigned int SignedDistanceField::c_noHint;
+
+void SignedDistanceField::batch_query(const float *_x, const float *_y, const float *_z, unsigned int _count, float *o_sdf,
+                                      unsigned int *io_hint, QueryStats *io_stats) const
+{
+    batchQuery(_x, _y, _z, _count, FLT_MAX, o_sdf, io_hint, io_stats);
+}
+
+void SignedDistanceField::batch_query(const float *_x, const float *_y, const float *_z, unsigned int _count, float _maxRadius,
+                                      float *o_sdf, unsigned int *io_hint, QueryStats *io_stats) const
+{
+    batchQuery(_x, _y, _z, _count, _maxRadius*_maxRadius, o_sdf, io_hint, io_stats);
+}
+
+void SignedDistanceField::batchQuery(const float *_x, const float *_y, const float *_z, unsigned int _count, float _maxDist2,
+                                     float *o_sdf, unsigned int *io_hint, QueryStats *io_stats) const
+{
+    if(!is_valid())
+    {
+        std::fill(o_sdf, o_sdf + _count, FLT_MAX);
+        return;
+    }
+    if(_count == 0)
+        return;
+
+    const unsigned int width = Lanes::c_width;
+    unsigned int triangles[width];
+    std::fill(triangles, triangles + width, io_hint ? *io_hint : c_noHint);
+    QueryStats stats;
+
+    unsigned int first = 0;
+    for(; first + width <= _count; first += width)
+    {
+        closestPacket<Lanes>(_x + first, _y + first, _z + first, _maxDist2, o_sdf + first, triangles, stats);
+        if(first == 0 && io_hint)
+            *io_hint = triangles[0];
+    }
+
+    // the last partial packet repeats its final point in the unused lanes
+    if(first < _count)
+    {
+        float x[width], y[width], z[width], sdf[width];
+        for(unsigned int l = 0; l < width; l++)
+        {
+            const unsigned int i = std::min(first + l, _count - 1);
+            x[l] = _x[i];
+            y[l] = _y[i];
+            z[l] = _z[i];
+        }
+        closestPacket<Lanes>(x, y, z, _maxDist2, sdf, triangles, stats);
+        std::copy(sdf, sdf + (_count - first), o_sdf + first);
+        if(first == 0 && io_hint)
+            *io_hint = triangles[0];
+    }
+
+    if(io_stats)
+    {
+        // the repeated points of a partial packet are not counted as queries
+        io_stats->queries += _count;
+        io_stats->nodes += stats.nodes;
+        io_stats->triangles += stats.triangles;
+    }
+}
+
+float SignedDistanceField::query_with_hint(float x, float y, float z, unsigned int &io_hint, QueryStats *io_stats) const
+{
+    if(!is_valid())
+        return FLT_MAX;
+
+    glm::vec3 p(x, y, z), q;
+    float dist2 = FLT_MAX;
+    unsigned int triangle = 0;
+    Feature feature = FACE;
+
+    // the hinted triangle bounds the search, closest then only looks for strictly closer ones
+    if(io_hint < m_triangles.size())
+    {
+        triangle = io_hint;
+        q = closestPointOnTriangle(p, m_triangles[triangle], feature);
+        glm::vec3 d = p - q;
+        dist2 = glm::dot(d, d);
+        if(io_stats)
+            io_stats->triangles++;
+    }
+    closest(p, dist2, triangle, q, feature, io_stats);
+
+    io_hint = triangle;
+    return signedDistance(p, dist2, triangle, q, feature);
+}
+
+float SignedDistanceField::signedDistance(const glm::vec3 &_p, float _dist2, unsigned int _triangle, const glm::vec3 &_closest, Feature _feature) const
+{
+    const PseudoNormals &n = m_normals[_triangle];
+    glm::vec3 normal;
+    switch(_feature)
+    {
+    case FACE:     normal = n.face; break;
+    case EDGE_AB:  normal = n.edge[0]; break;
+    case EDGE_BC:  normal = n.edge[1]; break;
+    case EDGE_CA:  normal = n.edge[2]; break;
+    case VERTEX_A: normal = n.vertex[0]; break;
+    case VERTEX_B: normal = n.vertex[1]; break;
+    case VERTEX_C: normal = n.vertex[2]; break;
+    }
+
+    float dist = std::sqrt(_dist2);
+    return glm::dot(_p - _closest, normal) < 0.0f ? -dist : dist;
+}
+
+float SignedDistanceField::operator()(float x, float y, float z, float *o_closest) const
+{
+    if(!is_valid())
+        return FLT_MAX;
+
+    glm::vec3 p(x, y, z), q;
+    float dist2 = FLT_MAX;
+    unsigned int triangle = 0;
+    Feature feature = FACE;
+    closest(p, dist2, triangle, q, feature);
+
+    if(o_closest)
+    {
+        o_closest[0] = q.x;
+        o_closest[1] = q.y;
+        o_closest[2] = q.z;
+    }
+    return signedDistance(p, dist2, triangle, q, feature);
+}
+
+bool SignedDistanceField::operator()(float x, float y, float z, float _maxRadius, float *o_sdf, float *o_closest) const
+{
+    if(!is_valid())
+        return false;
+
+    glm::vec3 p(x, y, z), q;
+    float dist2 = _maxRadius*_maxRadius;
+    unsigned int triangle = 0;
+    Feature feature = FACE;
+    if(!closest(p, dist2, triangle, q, feature))
+        return false;
+
+    if(o_sdf)
+        *o_sdf = signedDistance(p, dist2, triangle, q, feature);
+    if(o_closest)
+    {
+        o_closest[0] = q.x;
+        o_closest[1] = q.y;
+        o_closest[2] = q.z;
+    }
+    return true;
+}
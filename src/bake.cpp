@@ -0,0 +1,261 @@
+#include "marchingcube.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Headless polygonization of a rig, builds without Qt or OpenGL so it can run on machines without a display.
+// Writes one file per mesh and offset level, named <prefix>_muscle<id>_<level> and <prefix>_bone<id>_<level>.
+
+namespace
+{
+    void usage(const char *_program)
+    {
+        std::cout<<"usage: "<<_program<<" [options] -d muscle.obj [-d muscle.obj ...] [-s bone.obj]\n"
+                 <<"  -d <obj>         add a dynamic mesh\n"
+                 <<"  -s <obj>         add a static mesh\n"
+                 <<"  -f <offset>      add an offset level, default 0.3\n"
+                 <<"  -r <samples>     samples along each axis of the volume, default 300\n"
+                 <<"  -b <x y z X Y Z> bounding box to sample, default -20 -20 -20 20 20 20\n"
+                 <<"  -v <size>        voxel edge length in world units instead of a number of samples\n"
+                 <<"  --tight          sample each mesh over its own bounds, implies --world\n"
+                 <<"  --world          write the meshes in world units instead of rescaling the box to [-1,1]\n"
+                 <<"  --oriented       sample each mesh along its principal axes, implies --world\n"
+                 <<"  --long <scale>   voxel length along the longest principal axis relative to the others, default 1\n"
+                 <<"  -o <prefix>      prefix of the output files, default bake\n"
+                 <<"  -t <threads>     worker threads, default every core\n"
+                 <<"  --binary         write binary meshes (see MarchingCube::writeBinary) instead of obj\n"
+                 <<"  --indexed        share vertices between triangles\n"
+                 <<"  --gradient       take indexed normals from the field gradient\n"
+                 <<"  --narrow-band    only sample near the surface\n"
+                 <<"  --octree <res>   polygonize with an octree at the given resolution\n"
+                 <<"  --cache          reuse the fields cached next to the meshes, as <mesh>.sdfcache files\n"
+                 <<"                   of 4 bytes per voxel (13.5MB per mesh at -r 150) left in their directory\n"
+                 <<"  --single-pass    sample the volumes of all the meshes together\n"
+                 <<"  --float          interpolate the triangle soup in single precision\n"
+                 <<"  --stream         sample the static meshes one plane at a time too, the muscles always are\n"
+                 <<"                   unless --narrow-band or --single-pass, which it overrides\n"
+                 <<"  --pipeline       extract planes while the next ones are sampled, for a single -f level\n"
+                 <<"                   without --indexed\n";
+    }
+
+    bool readFloat(const char *_text, float &o_value)
+    {
+        char *end;
+        o_value = std::strtof(_text, &end);
+        return end != _text && *end == '\0';
+    }
+
+    bool readUnsigned(const char *_text, unsigned int &o_value)
+    {
+        char *end;
+        const long value = std::strtol(_text, &end, 10);
+        o_value = static_cast<unsigned int>(value);
+        return end != _text && *end == '\0' && value >= 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> dynamicMeshes;
+    std::vector<std::string> staticMeshes;
+    std::vector<float> offsets;
+    std::string prefix = "bake";
+    unsigned int resolution = 300;
+    unsigned int octreeResolution = 0;
+    unsigned int threads = 0;
+    float bbox[6] = {-20.0f, -20.0f, -20.0f, 20.0f, 20.0f, 20.0f};
+    float voxelSize = 0.0f;
+    bool tight = false;
+    bool world = false;
+    bool oriented = false;
+    float longAxisScale = 1.0f;
+    bool binary = false;
+    bool indexed = false;
+    bool gradient = false;
+    bool narrowBand = false;
+    bool cache = false;
+    bool singlePass = false;
+    bool singlePrecision = false;
+    bool stream = false;
+    bool pipeline = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        // number of values the option still needs
+        const int remaining = argc - i - 1;
+        bool valid = true;
+
+        if(arg == "-d" && remaining >= 1)
+            dynamicMeshes.push_back(argv[++i]);
+        else if(arg == "-s" && remaining >= 1)
+            staticMeshes.push_back(argv[++i]);
+        else if(arg == "-f" && remaining >= 1)
+        {
+            float offset;
+            valid = readFloat(argv[++i], offset);
+            offsets.push_back(offset);
+        }
+        else if(arg == "-r" && remaining >= 1)
+            valid = readUnsigned(argv[++i], resolution) && resolution >= 2;
+        else if(arg == "-b" && remaining >= 6)
+        {
+            for(int n = 0; n < 6; n++)
+                valid = readFloat(argv[++i], bbox[n]) && valid;
+            valid = valid && bbox[0] < bbox[3] && bbox[1] < bbox[4] && bbox[2] < bbox[5];
+        }
+        else if(arg == "-v" && remaining >= 1)
+            valid = readFloat(argv[++i], voxelSize) && voxelSize > 0.0f;
+        else if(arg == "--tight")
+            tight = world = true;
+        else if(arg == "--world")
+            world = true;
+        else if(arg == "--oriented")
+            oriented = world = true;
+        else if(arg == "--long" && remaining >= 1)
+            valid = readFloat(argv[++i], longAxisScale) && longAxisScale > 0.0f;
+        else if(arg == "-o" && remaining >= 1)
+            prefix = argv[++i];
+        else if(arg == "-t" && remaining >= 1)
+            valid = readUnsigned(argv[++i], threads);
+        else if(arg == "--binary")
+            binary = true;
+        else if(arg == "--indexed")
+            indexed = true;
+        else if(arg == "--gradient")
+            gradient = indexed = true;
+        else if(arg == "--narrow-band")
+            narrowBand = true;
+        else if(arg == "--octree" && remaining >= 1)
+            valid = readUnsigned(argv[++i], octreeResolution) && octreeResolution >= 2;
+        else if(arg == "--cache")
+            cache = true;
+        else if(arg == "--single-pass")
+            singlePass = true;
+        else if(arg == "--float")
+            singlePrecision = true;
+        else if(arg == "--stream")
+            stream = true;
+        else if(arg == "--pipeline")
+            pipeline = true;
+        else if(arg == "-h" || arg == "--help")
+        {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+        else
+            valid = false;
+
+        if(!valid)
+        {
+            std::cerr<<"Invalid argument "<<arg<<"\n";
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(offsets.empty())
+        offsets.push_back(0.3f);
+
+    if(pipeline && indexed)
+        std::cerr<<"Warning: --pipeline does not apply to --indexed output, the meshes are streamed instead\n";
+    else if(pipeline && offsets.size() > 1)
+        std::cerr<<"Warning: --pipeline only applies to a single -f level, the levels share one sweep instead\n";
+
+    if(dynamicMeshes.empty())
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const int noDynamic = int(dynamicMeshes.size());
+    const int noStatic = int(staticMeshes.size());
+
+    MarchingCube bake(noDynamic, noStatic);
+    bake.m_volumeResolution = resolution;
+    bake.m_threadCount = threads;
+    bake.m_indexedOutput = indexed;
+    bake.m_gradientNormals = gradient;
+    bake.m_singlePrecision = singlePrecision;
+    bake.m_streamVolume = stream;
+    bake.m_pipelined = pipeline;
+    bake.m_narrowBand = narrowBand;
+    bake.m_voxelSize = voxelSize;
+    bake.m_tightBounds = tight;
+    bake.m_worldSpace = world;
+    bake.m_orientedBounds = oriented;
+    bake.m_longAxisScale = longAxisScale;
+    bake.m_octree = octreeResolution > 0;
+    if(octreeResolution > 0)
+        bake.m_octreeResolution = octreeResolution;
+    // updateOffsets samples every level in one sweep, or level by level for --narrow-band and --single-pass, the
+    // fields are only kept to reuse them between runs
+    bake.m_cacheFields = cache;
+    bake.m_diskCache = cache;
+    bake.m_sharedSampling = singlePass;
+    for(int n = 0; n < 3; n++)
+    {
+        bake.m_bboxMin[n] = bbox[n];
+        bake.m_bboxMax[n] = bbox[n+3];
+    }
+
+    bool loaded = true;
+    for(int i = 0; i < noDynamic; i++)
+        loaded = bake.addMesh(i+1, dynamicMeshes[i].c_str(), false) && loaded;
+    for(int i = 0; i < noStatic; i++)
+        loaded = bake.addMesh(i+1, staticMeshes[i].c_str(), true) && loaded;
+    if(!loaded)
+    {
+        std::cerr<<"Some meshes could not be loaded\n";
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // static meshes do not depend on the offset, updateOffsets copies them to the other levels
+    for(int k = 1; k <= noStatic; k++)
+        bake.polygonizeInto(0, noDynamic + (k-1), k, true);
+    bake.updateOffsets(offsets);
+
+    bool written = true;
+    for(unsigned int level = 0; level < offsets.size(); level++)
+    {
+        for(int i = 0; i < noDynamic + noStatic; i++)
+        {
+            const std::string name = prefix + (i < noDynamic ? "_muscle" + std::to_string(i+1)
+                                                             : "_bone" + std::to_string(i-noDynamic+1))
+                                     + "_" + std::to_string(level) + (binary ? ".bin" : ".obj");
+
+            const std::vector<float> &vertices = bake.m_offsetArray[level][i];
+            const std::vector<float> &normals = bake.m_normalOffsetArray[level][i];
+            const std::vector<unsigned int> &indices = bake.m_indexOffsetArray[level][i];
+
+            bool ok;
+            if(binary)
+                ok = MarchingCube::writeBinary(vertices, normals, indices, name);
+            else if(indexed)
+                ok = MarchingCube::write(vertices, normals, indices, name);
+            else
+                ok = MarchingCube::write(vertices, normals, name);
+            written = ok && written;
+
+            if(ok)
+                std::cout<<"Wrote "<<name<<"\n";
+            else
+                std::cerr<<"Could not write "<<name<<"\n";
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout<<"Baked "<<offsets.size()<<" offset levels in "<<elapsed.count()<<"s\n";
+
+    if(!written)
+    {
+        std::cerr<<"Some meshes could not be written\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,438 @@
+#include "marchingcube.h"
+#include "CellKernel.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Times each stage of the pipeline and prints the results as JSON, so runs can be compared by a script.
+// Every stage runs --repeat times on fixed inputs, the minimum and the median are reported along with a checksum
+// of the output, which changes if a stage no longer computes the same thing.
+
+namespace
+{
+    struct Result
+    {
+        std::string name;
+        std::string input;
+        unsigned long long items = 0;
+        std::vector<double> seconds;
+        double checksum = 0.0;
+        SignedDistanceField::QueryStats stats;
+    };
+
+    void usage(const char *_program)
+    {
+        std::cout<<"usage: "<<_program<<" [options]\n"
+                 <<"  -m <obj>              mesh for the sdf query benchmark, default the models of the rig\n"
+                 <<"  --resolutions <list>  comma separated volume resolutions, default 100,200,300\n"
+                 <<"  --queries <n>         sdf queries per mesh, default 100000\n"
+                 <<"  --repeat <n>          runs of every stage, default 3\n"
+                 <<"  -t <threads>          worker threads, default every core\n"
+                 <<"  -o <file>             write the JSON to a file instead of the standard output\n";
+    }
+
+    std::vector<double> timeRuns(unsigned int _repeat, const std::function<void()> &_func)
+    {
+        std::vector<double> seconds;
+        for(unsigned int r = 0; r < _repeat; r++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            _func();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            seconds.push_back(elapsed.count());
+        }
+        return seconds;
+    }
+
+    double median(std::vector<double> _values)
+    {
+        std::sort(_values.begin(), _values.end());
+        const size_t half = _values.size()/2;
+        return _values.size() % 2 ? _values[half] : 0.5*(_values[half-1] + _values[half]);
+    }
+
+    std::string escape(const std::string &_text)
+    {
+        std::string escaped;
+        for(char c : _text)
+        {
+            if(c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    /// @brief A rig of two dynamic muscles around a static bone, the scene GLWindow shows
+    /// @return nullptr if one of the meshes could not be loaded
+    MarchingCube *makeRig(unsigned int _threads, unsigned int _resolution)
+    {
+        MarchingCube *rig = new MarchingCube(2, 1);
+        rig->m_threadCount = _threads;
+        rig->m_volumeResolution = _resolution;
+        rig->m_offset = 0.3f;
+        bool loaded = rig->addMesh(1, "models/muscle1.obj", false);
+        loaded = rig->addMesh(2, "models/muscle2.obj", false) && loaded;
+        loaded = rig->addMesh(1, "models/bone.obj", true) && loaded;
+        if(!loaded)
+        {
+            delete rig;
+            return nullptr;
+        }
+        return rig;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> meshes;
+    std::vector<unsigned int> resolutions;
+    unsigned int noQueries = 100000;
+    unsigned int repeat = 3;
+    unsigned int threads = 0;
+    std::string output;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if(arg == "-m" && hasValue)
+            meshes.push_back(argv[++i]);
+        else if(arg == "--resolutions" && hasValue)
+        {
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while(std::getline(list, item, ','))
+                resolutions.push_back(static_cast<unsigned int>(std::atoi(item.c_str())));
+        }
+        else if(arg == "--queries" && hasValue)
+            noQueries = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if(arg == "--repeat" && hasValue)
+            repeat = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if(arg == "-t" && hasValue)
+            threads = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if(arg == "-o" && hasValue)
+            output = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if(meshes.empty())
+        meshes = {"models/muscle1.obj", "models/muscle2.obj", "models/bone.obj"};
+    if(resolutions.empty())
+        resolutions = {100, 200, 300};
+    if(repeat == 0)
+        repeat = 1;
+
+    for(unsigned int resolution : resolutions)
+    {
+        if(resolution < 2)
+        {
+            std::cerr<<"Resolutions must be at least 2\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // progress goes to std::cerr so the JSON can be piped
+    std::streambuf *progress = std::cout.rdbuf(std::cerr.rdbuf());
+
+    std::vector<Result> results;
+
+    // raw sdf queries at fixed random points around each mesh
+    for(const std::string &path : meshes)
+    {
+        SignedDistanceField field;
+        if(!field.load_from_file(path))
+        {
+            std::cerr<<path<<" NOT FOUND\n";
+            return EXIT_FAILURE;
+        }
+
+        std::mt19937 random(1234);
+        std::vector<glm::vec3> points(noQueries);
+        for(glm::vec3 &p : points)
+        {
+            for(int n = 0; n < 3; n++)
+            {
+                // the box grown by a fifth on each side, so both sides of the surface are sampled
+                const float lo = field.minimum_bound()[n], hi = field.maximum_bound()[n];
+                const float margin = 0.2f*(hi - lo);
+                std::uniform_real_distribution<float> coordinate(lo - margin, hi + margin);
+                p[n] = coordinate(random);
+            }
+        }
+
+        Result result;
+        result.name = "sdf_query";
+        result.input = path;
+        result.items = noQueries;
+        result.seconds = timeRuns(repeat, [&]()
+        {
+            double sum = 0.0;
+            for(const glm::vec3 &p : points)
+                sum += field(p.x, p.y, p.z);
+            result.checksum = sum;
+        });
+        results.push_back(result);
+
+        // a grid of about as many points, queried one at a time then a row at a time as PrepareVolume does.
+        // Packets only pay off on coherent points, on the random points above they are slower
+        const unsigned int side = std::max(2u, static_cast<unsigned int>(std::cbrt(double(noQueries))));
+        const unsigned int noGrid = side*side*side;
+        std::vector<float> xs(noGrid), ys(noGrid), zs(noGrid), distances(noGrid);
+        for(unsigned int q = 0; q < noGrid; q++)
+        {
+            const unsigned int index[3] = {q/(side*side), (q/side) % side, q % side};
+            float *coordinates[3] = {&xs[q], &ys[q], &zs[q]};
+            for(int n = 0; n < 3; n++)
+            {
+                const float lo = field.minimum_bound()[n], hi = field.maximum_bound()[n];
+                const float margin = 0.2f*(hi - lo);
+                *coordinates[n] = lo - margin + (hi - lo + 2.0f*margin)*index[n]/float(side - 1);
+            }
+        }
+
+        Result grid;
+        grid.name = "sdf_grid_query";
+        grid.input = path;
+        grid.items = noGrid;
+        grid.seconds = timeRuns(repeat, [&]()
+        {
+            double sum = 0.0;
+            grid.stats = SignedDistanceField::QueryStats();
+            for(unsigned int q = 0; q < noGrid; q++)
+            {
+                unsigned int hint = SignedDistanceField::c_noHint;
+                sum += field.query_with_hint(xs[q], ys[q], zs[q], hint, &grid.stats);
+            }
+            grid.checksum = sum;
+        });
+        results.push_back(grid);
+
+        Result hinted;
+        hinted.name = "sdf_hinted_query";
+        hinted.input = path;
+        hinted.items = noGrid;
+        hinted.seconds = timeRuns(repeat, [&]()
+        {
+            double sum = 0.0;
+            hinted.stats = SignedDistanceField::QueryStats();
+            unsigned int hint = SignedDistanceField::c_noHint;
+            for(unsigned int q = 0; q < noGrid; q++)
+                sum += field.query_with_hint(xs[q], ys[q], zs[q], hint, &hinted.stats);
+            hinted.checksum = sum;
+        });
+        results.push_back(hinted);
+
+        Result batch;
+        batch.name = "sdf_batch_query";
+        batch.input = path;
+        batch.items = noGrid;
+        batch.seconds = timeRuns(repeat, [&]()
+        {
+            batch.stats = SignedDistanceField::QueryStats();
+            unsigned int hint = SignedDistanceField::c_noHint;
+            for(unsigned int first = 0; first < noGrid; first += side)
+                field.batch_query(&xs[first], &ys[first], &zs[first], side, &distances[first], &hint, &batch.stats);
+            double sum = 0.0;
+            for(float d : distances)
+                sum += d;
+            batch.checksum = sum;
+        });
+        results.push_back(batch);
+    }
+
+    // sampling the blended field of a dynamic muscle
+    for(unsigned int resolution : resolutions)
+    {
+        MarchingCube *rig = makeRig(threads, resolution);
+        if(!rig)
+            return EXIT_FAILURE;
+
+        // row by row, then brick by brick along a Morton curve
+        for(bool morton : {false, true})
+        {
+            rig->m_mortonOrder = morton;
+
+            Result result;
+            result.name = morton ? "prepare_volume_morton" : "prepare_volume";
+            result.input = std::to_string(resolution);
+            result.items = static_cast<unsigned long long>(resolution)*resolution*resolution;
+            result.seconds = timeRuns(repeat, [&]()
+            {
+                rig->PrepareVolume(1, false);
+            });
+            double sum = 0.0;
+            for(unsigned int v = 0; v < rig->m_volume_size; v++)
+                sum += rig->volumeData[v];
+            result.checksum = sum;
+            results.push_back(result);
+        }
+
+        delete rig;
+    }
+
+    // marching cubes alone, on a synthetic field of two blended spheres
+    {
+        const unsigned int size = 128;
+        std::vector<float> volume(size*size*size);
+        for(unsigned int i = 0; i < size; i++)
+            for(unsigned int j = 0; j < size; j++)
+                for(unsigned int k = 0; k < size; k++)
+                {
+                    const glm::vec3 p(i, j, k);
+                    const float a = glm::length(p - glm::vec3(48.0f, 64.0f, 64.0f)) - 30.0f;
+                    const float b = glm::length(p - glm::vec3(84.0f, 64.0f, 60.0f)) - 24.0f;
+                    volume[i*size*size + j*size + k] = std::min(a, b) + 1.5f*std::sin(0.3f*j);
+                }
+
+        MarchingCube cubes(0, 0);
+        Result result;
+        result.name = "marching_triangles";
+        result.input = std::to_string(size);
+        result.items = static_cast<unsigned long long>(size-1)*(size-1)*(size-1);
+        result.seconds = timeRuns(repeat, [&]()
+        {
+            std::vector<TRIANGLE> triangles;
+            GRIDCELL grid;
+            for(unsigned int i = 0; i < size-1; i++)
+                for(unsigned int j = 0; j < size-1; j++)
+                    for(unsigned int k = 0; k < size-1; k++)
+                    {
+                        static const unsigned int corner[8][3] = {{0,0,0},{1,0,0},{1,1,0},{0,1,0},{0,0,1},{1,0,1},{1,1,1},{0,1,1}};
+                        for(int c = 0; c < 8; c++)
+                        {
+                            const unsigned int x = i + corner[c][0], y = j + corner[c][1], z = k + corner[c][2];
+                            grid.p[c] = glm::vec3(x, y, z);
+                            grid.val[c] = volume[x*size*size + y*size + z];
+                        }
+                        cubes.MarchingTriangles(grid, 0.0f, triangles);
+                    }
+            double sum = 0.0;
+            for(const TRIANGLE &t : triangles)
+                sum += t.p[0].x + t.p[1].y + t.p[2].z;
+            result.checksum = sum;
+        });
+        results.push_back(result);
+
+        // the same cells through marchCell, reading the corners from the volume, in both precisions
+        for(int single = 0; single < 2; single++)
+        {
+            Result cell;
+            cell.name = single ? "march_cell_float" : "march_cell_double";
+            cell.input = result.input;
+            cell.items = result.items;
+            cell.seconds = timeRuns(repeat, [&]()
+            {
+                std::vector<glm::vec3> vertices;
+                glm::vec3 cellVertices[15];
+                for(unsigned int i = 0; i < size-1; i++)
+                    for(unsigned int j = 0; j < size-1; j++)
+                        for(unsigned int k = 0; k < size-1; k++)
+                        {
+                            const float *plane0 = &volume[i*size*size], *plane1 = &volume[(i+1)*size*size];
+                            const unsigned int n = single ?
+                                        marchCell<float>(plane0, plane1, size, j*size + k, glm::vec3(i, j, k), 0.0f, cellVertices) :
+                                        marchCell<double>(plane0, plane1, size, j*size + k, glm::vec3(i, j, k), 0.0f, cellVertices);
+                            vertices.insert(vertices.end(), cellVertices, cellVertices + n*3);
+                        }
+                double sum = 0.0;
+                for(size_t v = 0; v + 2 < vertices.size(); v += 3)
+                    sum += vertices[v].x + vertices[v+1].y + vertices[v+2].z;
+                cell.checksum = sum;
+            });
+            results.push_back(cell);
+        }
+    }
+
+    // a whole muscle, then its export
+    {
+        const unsigned int resolution = resolutions.front();
+        MarchingCube *rig = makeRig(threads, resolution);
+        if(!rig)
+            return EXIT_FAILURE;
+
+        // the Morton run goes first so the row by row mesh is the one written below
+        for(bool morton : {true, false})
+        {
+            rig->m_mortonOrder = morton;
+
+            Result polygonize;
+            polygonize.name = morton ? "polygonize_morton" : "polygonize";
+            polygonize.input = std::to_string(resolution);
+            polygonize.seconds = timeRuns(repeat, [&]()
+            {
+                rig->m_verts.clear();
+                rig->m_vertsNormal.clear();
+                rig->m_indices.clear();
+                rig->Polygonize(1, false);
+            });
+            polygonize.items = rig->m_verts.size()/9;
+            for(float v : rig->m_verts)
+                polygonize.checksum += v;
+            results.push_back(polygonize);
+        }
+
+        const std::string destination = "bench_write.obj";
+        Result write;
+        write.name = "write";
+        write.input = std::to_string(resolution);
+        write.items = rig->m_verts.size()/9;
+        write.seconds = timeRuns(repeat, [&]()
+        {
+            MarchingCube::write(rig->m_verts, rig->m_vertsNormal, destination);
+        });
+        std::remove(destination.c_str());
+        results.push_back(write);
+
+        delete rig;
+    }
+
+    std::cout.rdbuf(progress);
+
+    std::ofstream file;
+    if(!output.empty())
+    {
+        file.open(output);
+        if(!file)
+        {
+            std::cerr<<"Could not write "<<output<<"\n";
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream &json = output.empty() ? std::cout : file;
+
+    json.precision(9);
+    json<<"{\n  \"threads\": "<<resolveThreadCount(threads)<<",\n  \"repeat\": "<<repeat<<",\n  \"results\": [\n";
+    for(size_t r = 0; r < results.size(); r++)
+    {
+        const Result &result = results[r];
+        const double best = *std::min_element(result.seconds.begin(), result.seconds.end());
+        json<<"    {\"name\": \""<<result.name<<"\", \"input\": \""<<escape(result.input)<<"\", \"items\": "<<result.items
+            <<", \"min_s\": "<<best<<", \"median_s\": "<<median(result.seconds)
+            <<", \"items_per_s\": "<<(best > 0.0 ? result.items/best : 0.0)
+            <<", \"checksum\": "<<result.checksum;
+        if(result.stats.queries > 0)
+        {
+            json<<", \"nodes_per_query\": "<<double(result.stats.nodes)/result.stats.queries
+                <<", \"triangles_per_query\": "<<double(result.stats.triangles)/result.stats.queries;
+        }
+        json<<"}"<<(r + 1 < results.size() ? ",\n" : "\n");
+    }
+    json<<"  ]\n}\n";
+
+    return EXIT_SUCCESS;
+}
@@ -1,414 +1,1998 @@
 #include "marchingcube.h"
+#include "ParallelFor.h"
+#include "FieldCache.h"
+#include "SignMask.h"
+#include "CellKernel.h"
+#include "BoundedQueue.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 
 
 MarchingCube::MarchingCube(int noDynamic, int noStatic)
 {
+    isolevel = 0.0;
+
+    volumeData = nullptr;
+
+    m_volume_size = 0;
 
     m_noDynamic = noDynamic;
 
     m_noStatic = noStatic;
 
+    m_dynObj.resize(m_noDynamic);
+    m_staticObj.resize(m_noStatic);
+    m_dynFields.resize(m_noDynamic);
+    m_staticFields.resize(m_noStatic);
+    m_dynPaths.resize(m_noDynamic);
+    m_staticPaths.resize(m_noStatic);
+
+    // the levels GLWindow offers, bake adds more through polygonizeInto
+    addOffsetLevels(10);
+
     std::cout<<"Number of dynamic "<<m_noDynamic<<"\n";
 
     std::cout<<"Number of static "<<m_noStatic<<"\n";
 }
 
+MarchingCube::~MarchingCube()
+{
+    delete [] volumeData;
+}
+
+
+bool MarchingCube::addMesh(int _id, const char* _meshPath, bool _static)
+{
+    mesh &target = _static ? m_staticObj[_id-1] : m_dynObj[_id-1];
+
+    const bool loaded = target.load_from_file(_meshPath);
+    if (!loaded)
+        std::cerr<<_meshPath<< " NOT FOUND\n";
+
+    (_static ? m_staticPaths[_id-1] : m_dynPaths[_id-1]) = _meshPath;
+
+    clearFields();
+    updateMeshTree();
+    return loaded;
+}
+
+void MarchingCube::updateMeshTree()
+{
+    std::vector<glm::vec3> boxMin(m_noDynamic + m_noStatic, glm::vec3(FLT_MAX));
+    std::vector<glm::vec3> boxMax(m_noDynamic + m_noStatic, glm::vec3(-FLT_MAX));
+    for (int m = 0; m < m_noDynamic + m_noStatic; m++)
+    {
+        const mesh &obj = m < m_noDynamic ? m_dynObj[m] : m_staticObj[m - m_noDynamic];
+        if (obj.is_valid())
+        {
+            boxMin[m] = glm::vec3(obj.minimum_bound()[0], obj.minimum_bound()[1], obj.minimum_bound()[2]);
+            boxMax[m] = glm::vec3(obj.maximum_bound()[0], obj.maximum_bound()[1], obj.maximum_bound()[2]);
+        }
+    }
+    m_meshTree.build(boxMin, boxMax);
+}
+
+void MarchingCube::addOffsetLevels(int _noLevels)
+{
+    const unsigned int noSlots = m_noDynamic + m_noStatic;
+    if (_noLevels > int(m_offsetArray.size()))
+    {
+        m_offsetArray.resize(_noLevels, std::vector<std::vector<float>>(noSlots));
+        m_normalOffsetArray.resize(_noLevels, std::vector<std::vector<float>>(noSlots));
+        m_indexOffsetArray.resize(_noLevels, std::vector<std::vector<unsigned int>>(noSlots));
+    }
+}
+
+float MarchingCube::offsetMesh(glm::vec3 pos, int objNo)
+{
+    // Current Muscle
+    const float current = m_dynObj[objNo-1](pos.x,pos.y,pos.z);
+
+    float blended;
+    blendRow(&pos.x, &pos.y, &pos.z, 1, objNo, &current,
+             [&](unsigned int _mesh, const unsigned int *, unsigned int, float *o_distances)
+    {
+        const mesh &obj = int(_mesh) < m_noDynamic ? m_dynObj[_mesh] : m_staticObj[_mesh - m_noDynamic];
+        o_distances[0] = obj(pos.x,pos.y,pos.z);
+    }, &blended);
+
+    return blended;
+}
+
+void MarchingCube::blendRow(const float *x, const float *y, const float *z, unsigned int count, int meshNo, const float *_current,
+                            const std::function<void(unsigned int, const unsigned int *, unsigned int, float *)> &_distances,
+                            float *o_row)
+{
+    blendRows(x, y, z, count, meshNo, _current, _distances, &m_offset, 1, &o_row);
+}
+
+void MarchingCube::blendRows(const float *x, const float *y, const float *z, unsigned int count, int meshNo, const float *_current,
+                             const std::function<void(unsigned int, const unsigned int *, unsigned int, float *)> &_distances,
+                             const float *_offsets, unsigned int _noOffsets, float *const *o_rows)
+{
+    if (count == 0)
+        return;
+
+    glm::vec3 rowMin(x[0], y[0], z[0]);
+    glm::vec3 rowMax = rowMin;
+    for (unsigned int k = 1; k < count; k++)
+    {
+        rowMin = glm::min(rowMin, glm::vec3(x[k], y[k], z[k]));
+        rowMax = glm::max(rowMax, glm::vec3(x[k], y[k], z[k]));
+    }
+
+    std::vector<unsigned int> neighbours;
+    m_meshTree.query(rowMin, rowMax, m_neighbourRadius, neighbours);
+
+    // a row per neighbour in reach of the row, c_farNeighbour at the samples it is too far from, and a spare one
+    const float radius2 = m_neighbourRadius*m_neighbourRadius;
+    std::vector<float> rows((neighbours.size() + 1)*count, c_farNeighbour);
+    std::vector<const float *> src(1, _current);
+    std::vector<const float *> sta;
+    std::vector<unsigned int> samples;
+    std::vector<float> distances;
+    unsigned int r = 0;
+    for (unsigned int m : neighbours)
+    {
+        if (int(m) == meshNo-1)
+            continue;
+
+        samples.clear();
+        for (unsigned int k = 0; k < count; k++)
+        {
+            if (m_meshTree.distance2(m, glm::vec3(x[k], y[k], z[k])) <= radius2)
+                samples.push_back(k);
+        }
+        if (samples.empty())
+            continue;
+
+        distances.resize(samples.size());
+        _distances(m, samples.data(), samples.size(), distances.data());
+
+        float *row = &rows[r*count];
+        r++;
+        for (unsigned int n = 0; n < samples.size(); n++)
+        {
+            row[samples[n]] = distances[n];
+        }
+        (int(m) < m_noDynamic ? src : sta).push_back(row);
+    }
+
+    // the other muscles of a rig are still there when all of them are out of reach, which the blend of a single
+    // muscle would not account for
+    if (m_noDynamic > 1 && src.size() == 1)
+    {
+        src.push_back(&rows[r*count]);
+    }
+
+    const int noDynamic = int(src.size());
+    const int noStatic = int(sta.size());
+    const BlendRowKernel kernel = selectBlendRowKernel(noDynamic, noStatic);
+
+    // the offset depends on the height, so the kernel runs over each stretch of samples at the same height, which is
+    // the whole row on an axis aligned grid
+    std::vector<const float *> srcRun(noDynamic);
+    std::vector<const float *> staRun(noStatic);
+    unsigned int first = 0;
+    while (first < count)
+    {
+        unsigned int last = first + 1;
+        while (last < count && y[last] == y[first])
+        {
+            last++;
+        }
+        for (int i = 0; i < noDynamic; i++)
+        {
+            srcRun[i] = src[i] + first;
+        }
+        for (int i = 0; i < noStatic; i++)
+        {
+            staRun[i] = sta[i] + first;
+        }
+        for (unsigned int l = 0; l < _noOffsets; l++)
+        {
+            kernel(noDynamic, noStatic, srcRun.data(), staRun.data(), last - first, offsetAtHeight(_offsets[l], y[first]), o_rows[l] + first);
+        }
+        first = last;
+    }
+}
+
+// Spreads the low 21 bits of _v three bits apart, for Morton codes
+static unsigned long long spreadBits(unsigned long long _v)
+{
+    _v &= 0x1fffff;
+    _v = (_v | _v << 32) & 0x1f00000000ffffULL;
+    _v = (_v | _v << 16) & 0x1f0000ff0000ffULL;
+    _v = (_v | _v << 8) & 0x100f00f00f00f00fULL;
+    _v = (_v | _v << 4) & 0x10c30c30c30c30c3ULL;
+    _v = (_v | _v << 2) & 0x1249249249249249ULL;
+    return _v;
+}
+
+// The bricks of a grid of noBricks bricks sorted along a Z-order (Morton) curve, so consecutive bricks are neighbours
+static std::vector<glm::uvec3> mortonBricks(const unsigned int noBricks[3])
+{
+    std::vector<std::pair<unsigned long long, glm::uvec3>> coded;
+    coded.reserve(static_cast<size_t>(noBricks[0])*noBricks[1]*noBricks[2]);
+    for (unsigned int bi = 0; bi < noBricks[0]; bi++)
+        for (unsigned int bj = 0; bj < noBricks[1]; bj++)
+            for (unsigned int bk = 0; bk < noBricks[2]; bk++)
+                coded.push_back({spreadBits(bi) << 2 | spreadBits(bj) << 1 | spreadBits(bk), glm::uvec3(bi, bj, bk)});
+
+    std::sort(coded.begin(), coded.end(), [](const std::pair<unsigned long long, glm::uvec3> &_a,
+                                             const std::pair<unsigned long long, glm::uvec3> &_b)
+    {
+        return _a.first < _b.first;
+    });
+
+    std::vector<glm::uvec3> bricks(coded.size());
+    for (size_t b = 0; b < coded.size(); b++)
+    {
+        bricks[b] = coded[b].second;
+    }
+    return bricks;
+}
+
+// Appends _parts to o_merged in order. The sizes are counted then scanned so every part knows where it goes, and the
+// parts are copied in parallel. _parts are emptied
+template<typename T>
+static void mergeParts(std::vector<std::vector<T>> &_parts, unsigned int _threads, std::vector<T> &o_merged)
+{
+    std::vector<size_t> first(_parts.size() + 1, o_merged.size());
+    for (size_t p = 0; p < _parts.size(); p++)
+    {
+        first[p + 1] = first[p] + _parts[p].size();
+    }
+
+    o_merged.resize(first.back());
+    parallelFor(0, _parts.size(), _threads, [&](unsigned int p)
+    {
+        std::copy(_parts[p].begin(), _parts[p].end(), o_merged.begin() + first[p]);
+        std::vector<T>().swap(_parts[p]);
+    });
+}
+
+void MarchingCube::samplingGrid(int meshNo, bool _static, unsigned int _resolution, float *o_min, float *o_max, float *o_disp, unsigned int *o_dims, glm::vec3 *o_axes) const
+{
+    for (int n = 0; n < 3; n++)
+    {
+        o_axes[n] = glm::vec3(0.0f);
+        o_axes[n][n] = 1.0f;
+
+        // find dispacement, eg bounding box width divided by volume width
+        const float extent = m_bboxMax[n] - m_bboxMin[n];
+        o_disp[n] = m_voxelSize > 0.0f ? m_voxelSize : extent/static_cast<float>(_resolution);
+
+        if (!m_tightBounds)
+        {
+            o_min[n] = m_bboxMin[n];
+            if (m_voxelSize > 0.0f)
+            {
+                o_dims[n] = std::max(2u, static_cast<unsigned int>(std::ceil(extent/m_voxelSize)));
+                o_max[n] = o_min[n] + o_disp[n]*static_cast<float>(o_dims[n]);
+            }
+            else
+            {
+                o_dims[n] = _resolution;
+                o_max[n] = m_bboxMax[n];
+            }
+        }
+    }
+    if (!m_tightBounds && !m_orientedBounds)
+        return;
+
+    // The surface stays within |isolevel| and the offset of the mesh, two more voxels keep the border of the grid
+    // outside of it
+    const mesh &obj = _static ? m_staticObj[meshNo-1] : m_dynObj[meshNo-1];
+    const float padding = fabs(isolevel) + (_static ? 0.0f : fabs(m_offset));
+
+    if (m_orientedBounds)
+    {
+        // the finest voxel of the box across the muscle, stretched by m_longAxisScale along it
+        const float voxel = m_voxelSize > 0.0f ? m_voxelSize : std::min(o_disp[0], std::min(o_disp[1], o_disp[2]));
+        glm::vec3 lo, hi;
+        obj.oriented_bounds(o_axes, lo, hi);
+        for (int n = 0; n < 3; n++)
+        {
+            o_disp[n] = n == 2 ? voxel*m_longAxisScale : voxel;
+            o_min[n] = lo[n] - padding - 2.0f*o_disp[n];
+            o_dims[n] = static_cast<unsigned int>(std::ceil((hi[n] + padding + 2.0f*o_disp[n] - o_min[n])/o_disp[n])) + 1;
+            o_max[n] = o_min[n] + o_disp[n]*static_cast<float>(o_dims[n]);
+        }
+        return;
+    }
+
+    // snapped to the lattice of m_bboxMin so every mesh is sampled at the same positions
+    for (int n = 0; n < 3; n++)
+    {
+        const float lo = obj.minimum_bound()[n] - padding - 2.0f*o_disp[n];
+        const float hi = obj.maximum_bound()[n] + padding + 2.0f*o_disp[n];
+        o_min[n] = m_bboxMin[n] + o_disp[n]*std::floor((lo - m_bboxMin[n])/o_disp[n]);
+        o_dims[n] = static_cast<unsigned int>(std::ceil((hi - o_min[n])/o_disp[n])) + 1;
+        o_max[n] = o_min[n] + o_disp[n]*static_cast<float>(o_dims[n]);
+    }
+}
+
+void MarchingCube::setGrid(const float *_min, const float *_disp, const glm::vec3 *_axes)
+{
+    m_cellDiagonal = glm::length(glm::vec3(_disp[0], _disp[1], _disp[2]));
+    for (int n = 0; n < 3; n++)
+    {
+        m_gridMin[n] = _min[n];
+        m_gridDisp[n] = _disp[n];
+        m_gridAxes[n] = _axes[n];
+    }
+    m_gridOriented = m_orientedBounds;
+}
+
+glm::vec3 MarchingCube::gridToWorld(const glm::vec3 &_p) const
+{
+    if (!m_gridOriented)
+        return _p;
+
+    return m_gridAxes[0]*_p.x + m_gridAxes[1]*_p.y + m_gridAxes[2]*_p.z;
+}
+
+void MarchingCube::rowPositions(unsigned int i, unsigned int j, unsigned int kBegin, unsigned int count, float *o_x, float *o_y, float *o_z) const
+{
+    const float x = m_gridMin[0] + m_gridDisp[0]*static_cast<float>(i);
+    const float y = m_gridMin[1] + m_gridDisp[1]*static_cast<float>(j);
+    for (unsigned int k = 0; k < count; k++)
+    {
+        const glm::vec3 p = gridToWorld(glm::vec3(x, y, m_gridMin[2] + m_gridDisp[2]*static_cast<float>(kBegin + k)));
+        o_x[k] = p.x;
+        o_y[k] = p.y;
+        o_z[k] = p.z;
+    }
+}
+
+glm::vec3 MarchingCube::outputPosition(const glm::vec3 &_p) const
+{
+    if (m_worldSpace || m_tightBounds || m_orientedBounds)
+    {
+        return gridToWorld(glm::vec3(m_gridMin[0] + m_gridDisp[0]*_p.x, m_gridMin[1] + m_gridDisp[1]*_p.y, m_gridMin[2] + m_gridDisp[2]*_p.z));
+    }
+
+    // rescaled to [-1,1]
+    return glm::vec3(_p.x/volume_width*2.0-1.0, _p.y/volume_height*2.0-1.0, _p.z/volume_depth*2.0-1.0);
+}
+
+glm::vec3 MarchingCube::outputNormal(const glm::vec3 &_n) const
+{
+    if (m_worldSpace || m_tightBounds || m_orientedBounds)
+    {
+        // normals take the inverse transpose of outputPosition, the inverse voxel size then the rotation
+        const glm::vec3 n = gridToWorld(glm::vec3(_n.x/m_gridDisp[0], _n.y/m_gridDisp[1], _n.z/m_gridDisp[2]));
+        return glm::dot(n, n) > 0.0f ? glm::normalize(n) : n;
+    }
+
+    // a uniform rescale keeps the direction, otherwise the inverse transpose of the scale of each axis
+    if (volume_width == volume_height && volume_width == volume_depth)
+        return _n;
+
+    const glm::vec3 n(_n.x*volume_width, _n.y*volume_height, _n.z*volume_depth);
+    return glm::dot(n, n) > 0.0f ? glm::normalize(n) : n;
+}
+
+// Creates volume on grid from implicit function
+bool MarchingCube::PrepareVolume(int meshNo, bool _static)
+{
+
+    float bbox_min[3], bbox_max[3], disp[3];
+    unsigned int dims[3];
+    glm::vec3 axes[3];
+    samplingGrid(meshNo, _static, m_volumeResolution, bbox_min, bbox_max, disp, dims, axes);
+
+    volume_width = dims[0];
+    volume_height = dims[1];
+    volume_depth = dims[2];
+
+    // the volume is reused between meshes, only reallocated when its size changes
+    if (volumeData == nullptr || m_volume_size != volume_width*volume_height*volume_depth)
+    {
+        delete [] volumeData;
+        m_volume_size = volume_width*volume_height*volume_depth;
+        volumeData = new float[m_volume_size];
+    }
+
+    setGrid(bbox_min, disp, axes);
+
+    // with tight or oriented bounds every mesh has its own grid, so there is nothing to share between them
+    const bool sharedGrid = !m_tightBounds && !m_orientedBounds;
+    if(m_cacheFields && sharedGrid)
+    {
+        PrepareFields(bbox_min, bbox_max, disp);
+
+        const unsigned int index = meshNo-1;
+        if(_static)
+        {
+            std::copy(m_staticFields[index].begin(), m_staticFields[index].end(), volumeData);
+            return true;
+        }
+
+        // only the blending of offsetMesh is left to do, on the cached distances
+        parallelFor(0, volume_width, m_threadCount, [&](unsigned int i)
+        {
+            std::vector<float> xs(volume_depth), ys(volume_depth), zs(volume_depth);
+            for (uint j = 0; j < volume_height; j++)
+            {
+                rowPositions(i, j, 0, volume_depth, xs.data(), ys.data(), zs.data());
+                const unsigned int row = voxelIndex(i, j, 0);
+
+                blendRow(xs.data(), ys.data(), zs.data(), volume_depth, meshNo, &m_dynFields[index][row],
+                         [&](unsigned int _mesh, const unsigned int *_samples, unsigned int _count, float *o_distances)
+                {
+                    const std::vector<float> &field = int(_mesh) < m_noDynamic ? m_dynFields[_mesh] : m_staticFields[_mesh - m_noDynamic];
+                    for (unsigned int n = 0; n < _count; n++)
+                    {
+                        o_distances[n] = field[row + _samples[n]];
+                    }
+                }, &volumeData[row]);
+            }
+        });
+        return true;
+    }
+
+    if(m_sharedSampling && sharedGrid)
+    {
+        PrepareSharedVolumes(bbox_min, bbox_max);
+
+        const std::vector<float> &shared = m_sharedVolumes[_static ? m_noDynamic + meshNo-1 : meshNo-1];
+        std::copy(shared.begin(), shared.end(), volumeData);
+        return true;
+    }
+
+    if(m_narrowBand)
+    {
+        PrepareNarrowBand(meshNo, _static, bbox_min, disp);
+        return true;
+    }
+
+    if(m_mortonOrder)
+    {
+        // bricks along a Morton curve keep the sdf queries of consecutive rows close together. Each brick writes
+        // only its own voxels, so they can be sampled in any order
+        const unsigned int brick = m_brickSize > 0 ? m_brickSize : 1;
+        const unsigned int dims[3] = {volume_width, volume_height, volume_depth};
+        const unsigned int noBricks[3] = {(dims[0] + brick - 1)/brick, (dims[1] + brick - 1)/brick, (dims[2] + brick - 1)/brick};
+        const std::vector<glm::uvec3> bricks = mortonBricks(noBricks);
+
+        parallelFor(0, bricks.size(), m_threadCount, [&](unsigned int b)
+        {
+            unsigned int lo[3], hi[3];
+            for (int n = 0; n < 3; n++)
+            {
+                lo[n] = bricks[b][n]*brick;
+                hi[n] = std::min(lo[n] + brick, dims[n]);
+            }
+
+            std::vector<unsigned int> hints(m_noDynamic + m_noStatic, mesh::c_noHint);
+            const unsigned int rowLength = hi[2] - lo[2];
+            std::vector<float> xs(rowLength), ys(rowLength), zs(rowLength);
+            for (unsigned int i = lo[0]; i < hi[0]; i++)
+            {
+                for (unsigned int j = lo[1]; j < hi[1]; j++)
+                {
+                    rowPositions(i, j, lo[2], rowLength, xs.data(), ys.data(), zs.data());
+                    sampleRow(xs.data(), ys.data(), zs.data(), rowLength, meshNo, _static, &volumeData[voxelIndex(i, j, lo[2])], hints.data());
+                }
+            }
+        });
+        return true;
+    }
+
+    // each x slab writes only its own part of volumeData, so slabs can be sampled in any order
+    parallelFor(0, volume_width, m_threadCount, [&](unsigned int i)
+    {
+        // each row starts from the closest triangles of the start of the previous one
+        std::vector<unsigned int> hints(m_noDynamic + m_noStatic, mesh::c_noHint);
+        std::vector<float> xs(volume_depth), ys(volume_depth), zs(volume_depth);
+        for (uint j = 0; j < volume_height; j++)
+        {
+            rowPositions(i, j, 0, volume_depth, xs.data(), ys.data(), zs.data());
+            sampleRow(xs.data(), ys.data(), zs.data(), volume_depth, meshNo, _static, &volumeData[voxelIndex(i, j, 0)], hints.data());
+        }
+    });
+     return true;
+}
+
+void MarchingCube::sampleRow(const float *x, const float *y, const float *z, unsigned int count, int meshNo, bool _static, float *o_row, unsigned int *io_hints)
+{
+    sampleRows(x, y, z, count, meshNo, _static, &m_offset, 1, &o_row, io_hints);
+}
 
-void MarchingCube::addMesh(int _id, const char* _meshPath, bool _static)
+void MarchingCube::sampleRows(const float *x, const float *y, const float *z, unsigned int count, int meshNo, bool _static,
+                              const float *_offsets, unsigned int _noOffsets, float *const *o_rows, unsigned int *io_hints)
+{
+    std::vector<float> distances(count);
+    std::vector<unsigned int> near;
+    sampleOwnRow(x, y, z, count, meshNo, _static, o_rows[0], distances.data(), near, &io_hints[_static ? m_noDynamic + meshNo-1 : meshNo-1]);
+
+    // away from the surface the samples are the same at every offset
+    for (unsigned int l = 1; l < _noOffsets; l++)
+    {
+        std::copy(o_rows[0], o_rows[0] + count, o_rows[l]);
+    }
+
+    const unsigned int noNear = near.size();
+    if (_static)
+    {
+        for (unsigned int l = 0; l < _noOffsets; l++)
+        {
+            for (unsigned int n = 0; n < noNear; n++)
+            {
+                o_rows[l][near[n]] = distances[near[n]];
+            }
+        }
+        return;
+    }
+    if (noNear == 0)
+        return;
+
+    // the other meshes at the samples left
+    std::vector<float> xs(noNear), ys(noNear), zs(noNear), own(noNear), blended(noNear*_noOffsets);
+    for (unsigned int n = 0; n < noNear; n++)
+    {
+        xs[n] = x[near[n]];
+        ys[n] = y[near[n]];
+        zs[n] = z[near[n]];
+        own[n] = distances[near[n]];
+    }
+    std::vector<float *> blendedRows(_noOffsets);
+    for (unsigned int l = 0; l < _noOffsets; l++)
+    {
+        blendedRows[l] = &blended[l*noNear];
+    }
+
+    std::vector<float> gathered[3] = {std::vector<float>(noNear), std::vector<float>(noNear), std::vector<float>(noNear)};
+    blendRows(xs.data(), ys.data(), zs.data(), noNear, meshNo, own.data(),
+             [&](unsigned int _mesh, const unsigned int *_samples, unsigned int _count, float *o_distances)
+    {
+        for (unsigned int n = 0; n < _count; n++)
+        {
+            gathered[0][n] = xs[_samples[n]];
+            gathered[1][n] = ys[_samples[n]];
+            gathered[2][n] = zs[_samples[n]];
+        }
+        const mesh &obj = int(_mesh) < m_noDynamic ? m_dynObj[_mesh] : m_staticObj[_mesh - m_noDynamic];
+        obj.batch_query(gathered[0].data(), gathered[1].data(), gathered[2].data(), _count, o_distances, &io_hints[_mesh]);
+    }, _offsets, _noOffsets, blendedRows.data());
+
+    for (unsigned int l = 0; l < _noOffsets; l++)
+    {
+        for (unsigned int n = 0; n < noNear; n++)
+        {
+            o_rows[l][near[n]] = blendedRows[l][n];
+        }
+    }
+}
+
+void MarchingCube::sampleOwnRow(const float *x, const float *y, const float *z, unsigned int count, int meshNo, bool _static,
+                                float *o_row, float *o_distances, std::vector<unsigned int> &o_near, unsigned int *io_hint)
+{
+    const mesh &current = _static ? m_staticObj[meshNo-1] : m_dynObj[meshNo-1];
+
+    // A sample whose own distance is further than farDistance from isolevel is not a corner of any cell the
+    // surface crosses, nor the neighbour of one when gradient normals are on, since the offset moves it by at most
+    // maxOffset. Only its side of isolevel matters, which the distance of the current mesh alone gives
+    const float maxOffset = _static ? 0.0f : fabs(m_offset);
+    const float farDistance = (m_gradientNormals ? 2.0f : 1.0f)*m_cellDiagonal + maxOffset;
+    const bool lazy = m_lazyOffset && m_cellDiagonal > 0.0f;
+
+    o_near.clear();
+    o_near.reserve(count);
+    if (lazy)
+    {
+        const float radius = fabs(isolevel) + farDistance;
+        current.batch_query(x, y, z, count, radius, o_distances, io_hint);
+
+        float sign = 0.0f;
+        for (unsigned int k = 0; k < count; k++)
+        {
+            if (o_distances[k] == FLT_MAX)
+            {
+                // Consecutive samples are closer than radius, so the surface cannot pass between this one and the
+                // previous one when this one is beyond radius. The first of a row has to ask
+                if (sign == 0.0f)
+                {
+                    sign = current(x[k], y[k], z[k]) < 0.0f ? -1.0f : 1.0f;
+                }
+                o_row[k] = isolevel + sign*radius;
+                continue;
+            }
+
+            sign = o_distances[k] < 0.0f ? -1.0f : 1.0f;
+            if (fabs(o_distances[k] - isolevel) > farDistance)
+            {
+                o_row[k] = o_distances[k];
+                continue;
+            }
+            o_near.push_back(k);
+        }
+    }
+    else
+    {
+        current.batch_query(x, y, z, count, o_distances, io_hint);
+        for (unsigned int k = 0; k < count; k++)
+        {
+            o_near.push_back(k);
+        }
+    }
+}
+
+float MarchingCube::sampleVolume(glm::vec3 pos, int meshNo, bool _static)
 {
     if(_static == false)
     {
-        if (!m_dynObj[_id-1].load_from_file(_meshPath))
-                std::cerr<<_meshPath<< " NOT FOUND";
+        return offsetMesh(pos, meshNo);
+    }
 
-        else
+    return m_staticObj[meshNo-1](pos.x,pos.y,pos.z);
+}
+
+// Samples the raw distance of every mesh once, see m_cacheFields
+void MarchingCube::PrepareFields(const float *bbox_min, const float *bbox_max, const float *disp)
+{
+    bool cached = m_fieldDims[0] == volume_width && m_fieldDims[1] == volume_height && m_fieldDims[2] == volume_depth;
+    for (int n = 0; n < 3; n++)
+    {
+        cached = cached && m_fieldBboxMin[n] == bbox_min[n] && m_fieldBboxMax[n] == bbox_max[n];
+    }
+    if (cached)
+        return;
+
+    std::vector<std::vector<float> *> fields(m_noDynamic + m_noStatic);
+    std::vector<const mesh *> objs(m_noDynamic + m_noStatic);
+    std::vector<const std::string *> paths(m_noDynamic + m_noStatic);
+    int noFields = 0;
+    for (int m = 0; m < m_noDynamic; m++)
+    {
+        fields[noFields] = &m_dynFields[m];
+        paths[noFields] = &m_dynPaths[m];
+        objs[noFields++] = &m_dynObj[m];
+    }
+    for (int m = 0; m < m_noStatic; m++)
+    {
+        fields[noFields] = &m_staticFields[m];
+        paths[noFields] = &m_staticPaths[m];
+        objs[noFields++] = &m_staticObj[m];
+    }
+
+    // fields found on disk are taken out of the list, the rest are sampled and written back
+    std::vector<FieldCacheHeader> headers(noFields, FieldCacheHeader());
+    std::vector<bool> hashed(noFields, false);
+    int noSampled = 0;
+    for (int f = 0; f < noFields; f++)
+    {
+        if (m_diskCache && !paths[f]->empty())
+        {
+            FieldCacheHeader &header = headers[f];
+            header.format = m_halfDiskCache ? 1 : 0;
+            header.dims[0] = volume_width;
+            header.dims[1] = volume_height;
+            header.dims[2] = volume_depth;
+            for (int n = 0; n < 3; n++)
+            {
+                header.bboxMin[n] = bbox_min[n];
+                header.bboxMax[n] = bbox_max[n];
+            }
+            hashed[f] = hashFile(*paths[f], header.meshHash);
+
+            if (hashed[f] && loadFieldCache(*paths[f] + ".sdfcache", header, *fields[f]))
+            {
+                std::cout<<"Loaded cached field "<<*paths[f]<<".sdfcache\n";
+                continue;
+            }
+        }
+
+        fields[noSampled] = fields[f];
+        objs[noSampled] = objs[f];
+        paths[noSampled] = paths[f];
+        headers[noSampled] = headers[f];
+        hashed[noSampled] = hashed[f];
+        noSampled++;
+    }
+    noFields = noSampled;
+
+    if (noFields > 0)
+    {
+        std::cout<<"Caching the fields of "<<noFields<<" meshes\n";
+    }
+
+    for (int f = 0; f < noFields; f++)
+    {
+        fields[f]->resize(volume_width*volume_height*volume_depth);
+    }
+
+    std::vector<float> zs(volume_depth);
+    for (uint k = 0; k < volume_depth; k++)
+    {
+        zs[k] = bbox_min[2] + disp[2]*static_cast<float>(k);
+    }
+
+    parallelFor(0, volume_width, m_threadCount, [&](unsigned int i)
+    {
+        float x = bbox_min[0] + disp[0]*static_cast<float>(i);
+        std::vector<float> xs(volume_depth, x), ys(volume_depth);
+        std::vector<unsigned int> hints(m_noDynamic + m_noStatic, mesh::c_noHint);
+        for (uint j = 0; j < volume_height; j++)
+        {
+            float y = bbox_min[1] + disp[1]*static_cast<float>(j);
+            std::fill(ys.begin(), ys.end(), y);
+            const unsigned int row = voxelIndex(i, j, 0);
+
+            for (int f = 0; f < noFields; f++)
+            {
+                objs[f]->batch_query(xs.data(), ys.data(), zs.data(), volume_depth, &(*fields[f])[row], &hints[f]);
+            }
+        }
+    });
+
+    for (int f = 0; f < noFields; f++)
+    {
+        if (hashed[f] && !saveFieldCache(*paths[f] + ".sdfcache", headers[f], *fields[f], m_halfDiskCache))
         {
-            m_dynObj[_id-1].load_from_file(_meshPath);
+            std::cerr<<"Could not write "<<*paths[f]<<".sdfcache\n";
         }
     }
 
+    m_fieldDims[0] = volume_width;
+    m_fieldDims[1] = volume_height;
+    m_fieldDims[2] = volume_depth;
+    for (int n = 0; n < 3; n++)
+    {
+        m_fieldBboxMin[n] = bbox_min[n];
+        m_fieldBboxMax[n] = bbox_max[n];
+    }
+}
+
+void MarchingCube::clearFields()
+{
+    for (auto &field : m_dynFields)
+        std::vector<float>().swap(field);
+    for (auto &field : m_staticFields)
+        std::vector<float>().swap(field);
+
+    m_fieldDims[0] = m_fieldDims[1] = m_fieldDims[2] = 0;
+
+    for (auto &volume : m_sharedVolumes)
+        std::vector<float>().swap(volume);
+    m_sharedDims[0] = m_sharedDims[1] = m_sharedDims[2] = 0;
+}
+
+// Samples the volumes of every mesh at once, see m_sharedSampling
+void MarchingCube::PrepareSharedVolumes(const float *bbox_min, const float *bbox_max)
+{
+    bool sampled = m_sharedDims[0] == volume_width && m_sharedDims[1] == volume_height && m_sharedDims[2] == volume_depth;
+    sampled = sampled && m_sharedOffset == m_offset && m_sharedIsolevel == isolevel;
+    sampled = sampled && m_sharedNeighbourRadius == m_neighbourRadius && m_sharedLazyOffset == m_lazyOffset;
+    sampled = sampled && m_sharedGradientNormals == m_gradientNormals;
+    for (int n = 0; n < 3; n++)
+    {
+        sampled = sampled && m_sharedBboxMin[n] == bbox_min[n] && m_sharedBboxMax[n] == bbox_max[n];
+    }
+    if (sampled)
+        return;
+
+    const unsigned int noMeshes = m_noDynamic + m_noStatic;
+    std::cout<<"Sampling the volumes of "<<noMeshes<<" meshes in one pass\n";
+
+    m_sharedVolumes.resize(noMeshes);
+    for (auto &volume : m_sharedVolumes)
+    {
+        volume.resize(m_volume_size);
+    }
+
+    const unsigned int D = volume_depth;
+    parallelFor(0, volume_width, m_threadCount, [&](unsigned int i)
+    {
+        std::vector<float> xs(D), ys(D), zs(D);
+        // the distances of each mesh along the row, the maximum float where it is not known yet
+        std::vector<std::vector<float>> distances(noMeshes, std::vector<float>(D));
+        std::vector<std::vector<unsigned int>> near(noMeshes);
+        std::vector<unsigned int> ownHints(noMeshes, mesh::c_noHint), hints(noMeshes, mesh::c_noHint);
+        std::vector<unsigned int> missing;
+        std::vector<float> gathered[3] = {std::vector<float>(D), std::vector<float>(D), std::vector<float>(D)};
+        std::vector<float> nearXs, nearYs, nearZs, own, blended;
+
+        for (uint j = 0; j < volume_height; j++)
+        {
+            rowPositions(i, j, 0, D, xs.data(), ys.data(), zs.data());
+            const unsigned int row = voxelIndex(i, j, 0);
+
+            for (unsigned int m = 0; m < noMeshes; m++)
+            {
+                const bool isStatic = int(m) >= m_noDynamic;
+                const int meshNo = isStatic ? m - m_noDynamic + 1 : m + 1;
+                float *out = &m_sharedVolumes[m][row];
+                sampleOwnRow(xs.data(), ys.data(), zs.data(), D, meshNo, isStatic, out, distances[m].data(), near[m], &ownHints[m]);
+                if (isStatic)
+                {
+                    for (unsigned int k : near[m])
+                    {
+                        out[k] = distances[m][k];
+                    }
+                }
+            }
+
+            for (int d = 0; d < m_noDynamic; d++)
+            {
+                const std::vector<unsigned int> &nearD = near[d];
+                const unsigned int noNear = nearD.size();
+                if (noNear == 0)
+                    continue;
+
+                nearXs.resize(noNear);
+                nearYs.resize(noNear);
+                nearZs.resize(noNear);
+                own.resize(noNear);
+                blended.resize(noNear);
+                for (unsigned int n = 0; n < noNear; n++)
+                {
+                    nearXs[n] = xs[nearD[n]];
+                    nearYs[n] = ys[nearD[n]];
+                    nearZs[n] = zs[nearD[n]];
+                    own[n] = distances[d][nearD[n]];
+                }
+
+                blendRow(nearXs.data(), nearYs.data(), nearZs.data(), noNear, d + 1, own.data(),
+                         [&](unsigned int _mesh, const unsigned int *_samples, unsigned int _count, float *o_distances)
+                {
+                    // only the samples no other dynamic mesh has asked for yet, or beyond the lazy radius, are queried
+                    std::vector<float> &known = distances[_mesh];
+                    missing.clear();
+                    for (unsigned int n = 0; n < _count; n++)
+                    {
+                        if (known[nearD[_samples[n]]] == FLT_MAX)
+                            missing.push_back(nearD[_samples[n]]);
+                    }
+                    if (!missing.empty())
+                    {
+                        for (unsigned int n = 0; n < missing.size(); n++)
+                        {
+                            gathered[0][n] = xs[missing[n]];
+                            gathered[1][n] = ys[missing[n]];
+                            gathered[2][n] = zs[missing[n]];
+                        }
+                        std::vector<float> queried(missing.size());
+                        const mesh &obj = int(_mesh) < m_noDynamic ? m_dynObj[_mesh] : m_staticObj[_mesh - m_noDynamic];
+                        obj.batch_query(gathered[0].data(), gathered[1].data(), gathered[2].data(), missing.size(), queried.data(), &hints[_mesh]);
+                        for (unsigned int n = 0; n < missing.size(); n++)
+                        {
+                            known[missing[n]] = queried[n];
+                        }
+                    }
+
+                    for (unsigned int n = 0; n < _count; n++)
+                    {
+                        o_distances[n] = known[nearD[_samples[n]]];
+                    }
+                }, blended.data());
+
+                float *out = &m_sharedVolumes[d][row];
+                for (unsigned int n = 0; n < noNear; n++)
+                {
+                    out[nearD[n]] = blended[n];
+                }
+            }
+        }
+    });
+
+    m_sharedDims[0] = volume_width;
+    m_sharedDims[1] = volume_height;
+    m_sharedDims[2] = volume_depth;
+    for (int n = 0; n < 3; n++)
+    {
+        m_sharedBboxMin[n] = bbox_min[n];
+        m_sharedBboxMax[n] = bbox_max[n];
+    }
+    m_sharedOffset = m_offset;
+    m_sharedIsolevel = isolevel;
+    m_sharedNeighbourRadius = m_neighbourRadius;
+    m_sharedLazyOffset = m_lazyOffset;
+    m_sharedGradientNormals = m_gradientNormals;
+}
+
+// Samples only the bricks the isosurface can pass through, see m_narrowBand
+void MarchingCube::PrepareNarrowBand(int meshNo, bool _static, const float *bbox_min, const float *disp)
+{
+    const mesh &obj = _static ? m_staticObj[meshNo-1] : m_dynObj[meshNo-1];
+    const unsigned int brick = m_brickSize > 0 ? m_brickSize : 1;
+    const unsigned int dims[3] = {volume_width, volume_height, volume_depth};
+    unsigned int noBricks[3];
+    for (int n = 0; n < 3; n++)
+    {
+        noBricks[n] = (dims[n] + brick - 1)/brick;
+    }
+
+    // offsetMesh moves the surface of the mesh by at most |m_offset|, static meshes are not offset
+    const float maxOffset = _static ? 0.0f : fabs(m_offset);
+    const float cellDiagonal = glm::length(glm::vec3(disp[0], disp[1], disp[2]));
+
+    std::atomic<unsigned int> bandBricks(0);
+
+    parallelFor(0, noBricks[0], m_threadCount, [&](unsigned int bi)
+    {
+        unsigned int lo[3], hi[3];
+        lo[0] = bi*brick;
+        hi[0] = std::min(lo[0] + brick, dims[0]) - 1;
+
+        for (unsigned int bj = 0; bj < noBricks[1]; bj++)
+        {
+            lo[1] = bj*brick;
+            hi[1] = std::min(lo[1] + brick, dims[1]) - 1;
+
+            // far bricks in a row share the sign of the previous far brick, 0 when unknown
+            float farSign = 0.0f;
+
+            for (unsigned int bk = 0; bk < noBricks[2]; bk++)
+            {
+                lo[2] = bk*brick;
+                hi[2] = std::min(lo[2] + brick, dims[2]) - 1;
+
+                glm::vec3 centre, halfExtent;
+                for (int n = 0; n < 3; n++)
+                {
+                    float first = bbox_min[n] + disp[n]*static_cast<float>(lo[n]);
+                    float last = bbox_min[n] + disp[n]*static_cast<float>(hi[n]);
+                    centre[n] = 0.5f*(first + last);
+                    halfExtent[n] = 0.5f*(last - first);
+                }
+                centre = gridToWorld(centre);
+
+                // A cell only straddles isolevel if its field crosses isolevel, where the mesh distance is within
+                // |isolevel| + maxOffset. Every corner of such a cell is within one cell diagonal of the crossing,
+                // so a brick further than this radius from the mesh cannot hold a corner of a straddling cell.
+                // Gradient normals also read the neighbours of those corners, one more cell away.
+                const float reach = m_gradientNormals ? 2.0f*cellDiagonal : cellDiagonal;
+                const float radius = glm::length(halfExtent) + reach + fabs(isolevel) + maxOffset;
+
+                float distance;
+                bool near = obj(centre.x, centre.y, centre.z, radius, &distance);
+
+                if (!near)
+                {
+                    // Consecutive brick centres are less than two radii apart, so the surface cannot pass
+                    // between two far bricks and the sign carries over. Otherwise ask for it.
+                    if (farSign == 0.0f)
+                    {
+                        farSign = obj(centre.x, centre.y, centre.z) < 0.0f ? -1.0f : 1.0f;
+                    }
+
+                    const float clamped = isolevel + farSign*radius;
+                    for (unsigned int i = lo[0]; i <= hi[0]; i++)
+                        for (unsigned int j = lo[1]; j <= hi[1]; j++)
+                            for (unsigned int k = lo[2]; k <= hi[2]; k++)
+                                volumeData[voxelIndex(i, j, k)] = clamped;
+                    continue;
+                }
+
+                farSign = 0.0f;
+                bandBricks++;
+
+                const unsigned int rowLength = hi[2] - lo[2] + 1;
+                std::vector<float> xs(rowLength), ys(rowLength), zs(rowLength);
+                std::vector<unsigned int> hints(m_noDynamic + m_noStatic, mesh::c_noHint);
+                for (unsigned int i = lo[0]; i <= hi[0]; i++)
+                {
+                    for (unsigned int j = lo[1]; j <= hi[1]; j++)
+                    {
+                        rowPositions(i, j, lo[2], rowLength, xs.data(), ys.data(), zs.data());
+                        sampleRow(xs.data(), ys.data(), zs.data(), rowLength, meshNo, _static, &volumeData[voxelIndex(i, j, lo[2])], hints.data());
+                    }
+                }
+            }
+        }
+    });
+
+    std::cout<<"Narrow band sampled "<<bandBricks<<" of "<<noBricks[0]*noBricks[1]*noBricks[2]<<" bricks\n";
+}
+
+void MarchingCube::run()
+{
+    int noOffsetLevels = 1;
+
+    // for each offset level
+    for( int i = 0; i<noOffsetLevels; i++)
+    {
+        m_offset = float(0.3);
+
+
+        std::cout<<"Polygonizing dynamic "<<"\n";
+        for(int j = 1; j<= m_noDynamic; j++)
+        {
+            polygonizeInto(i, j-1, j, false);
+        }
+        std::cout<<"Polygonizing static "<<"\n";
+        for(int k = 1; k<= m_noStatic; k++)
+        {
+            polygonizeInto(i, m_noDynamic + (k-1), k, true);
+        }
+
+
+
+
+        std::cout<<"Offset saved for offset "<<m_offset<<"\n";
+    }
+
+}
+
+void MarchingCube::updateOffset(float _offset, int _level)
+{
+    m_offset = _offset;
+
+    for(int j = 1; j<= m_noDynamic; j++)
+    {
+        polygonizeInto(_level, j-1, j, false);
+    }
+
+    // static meshes are not offset
+    addOffsetLevels(_level + 1);
+    if(_level != 0)
+    {
+        for(int k = 0; k < m_noStatic; k++)
+        {
+            m_offsetArray[_level][m_noDynamic + k] = m_offsetArray[0][m_noDynamic + k];
+            m_normalOffsetArray[_level][m_noDynamic + k] = m_normalOffsetArray[0][m_noDynamic + k];
+            m_indexOffsetArray[_level][m_noDynamic + k] = m_indexOffsetArray[0][m_noDynamic + k];
+        }
+    }
+
+    std::cout<<"Offset saved for offset "<<m_offset<<"\n";
+}
+
+void MarchingCube::updateOffsets(const std::vector<float> &_offsets, int _firstLevel)
+{
+    if (_offsets.empty())
+        return;
+
+    // the octree has no planes to share between the levels, and the narrow band, shared sampling and Morton order
+    // prepare whole volumes that the sweep would bypass
+    if (m_octree || m_narrowBand || m_sharedSampling || m_mortonOrder)
+    {
+        for (unsigned int l = 0; l < _offsets.size(); l++)
+        {
+            updateOffset(_offsets[l], _firstLevel + int(l));
+        }
+        return;
+    }
+
+    // the lazy radius of the largest offset holds for all of them, see sampleRows
+    m_offset = 0.0f;
+    for (float offset : _offsets)
+    {
+        if (fabs(offset) > fabs(m_offset))
+            m_offset = offset;
+    }
+
+    addOffsetLevels(_firstLevel + int(_offsets.size()));
+    for(int j = 1; j<= m_noDynamic; j++)
+    {
+        sweepOffsets(j, _offsets, _firstLevel);
+    }
+
+    // static meshes are not offset
+    for (unsigned int l = 0; l < _offsets.size(); l++)
+    {
+        const int level = _firstLevel + int(l);
+        if (level == 0)
+            continue;
+        for(int k = 0; k < m_noStatic; k++)
+        {
+            m_offsetArray[level][m_noDynamic + k] = m_offsetArray[0][m_noDynamic + k];
+            m_normalOffsetArray[level][m_noDynamic + k] = m_normalOffsetArray[0][m_noDynamic + k];
+            m_indexOffsetArray[level][m_noDynamic + k] = m_indexOffsetArray[0][m_noDynamic + k];
+        }
+    }
+
+    m_offset = _offsets.back();
+    std::cout<<"Offsets saved for "<<_offsets.size()<<" levels\n";
+}
+
+void MarchingCube::sweepOffsets(int meshNo, const std::vector<float> &_offsets, int _firstLevel)
+{
+    const unsigned int noLevels = _offsets.size();
+    std::cout<<"Polygonizing object "<<meshNo<<" at "<<noLevels<<" offsets\n";
+
+    std::vector<IndexedSweep> sweeps;
+    std::vector<std::vector<TRIANGLE>> triangles;
+    if (m_pipelined && !m_indexedOutput && noLevels == 1)
+    {
+        // a single level is what Polygonize pipelines, m_offset is that level, see updateOffsets
+        triangles.resize(1);
+        pipelinePlanes(meshNo, false, triangles[0]);
+    }
     else
     {
-        if (!m_staticObj[_id-1].load_from_file(_meshPath))
-                std::cerr<<_meshPath<< " NOT FOUND";
+        streamPlanes(meshNo, false, _offsets.data(), noLevels, sweeps, triangles);
+    }
+
+    for (unsigned int l = 0; l < noLevels; l++)
+    {
+        if (m_indexedOutput)
+        {
+            finishIndexed(sweeps[l]);
+        }
+        else
+        {
+            m_nVerts = triangles[l].size()*3;
+            storeTriangles(triangles[l]);
+        }
+
+        const int level = _firstLevel + int(l);
+        m_offsetArray[level][meshNo-1] = m_verts;
+        m_normalOffsetArray[level][meshNo-1] = m_vertsNormal;
+        m_indexOffsetArray[level][meshNo-1] = m_indices;
+
+        m_verts.clear();
+        m_vertsNormal.clear();
+        m_indices.clear();
+    }
+}
+
+bool MarchingCube::planeGrid(int meshNo, bool _static)
+{
+    float bbox_min[3], bbox_max[3], disp[3];
+    unsigned int dims[3];
+    glm::vec3 axes[3];
+    samplingGrid(meshNo, _static, m_volumeResolution, bbox_min, bbox_max, disp, dims, axes);
+    volume_width = dims[0];
+    volume_height = dims[1];
+    volume_depth = dims[2];
+    setGrid(bbox_min, disp, axes);
+
+    // the raw distances come from the cached fields when there are some, like in PrepareVolume
+    const bool cached = m_cacheFields && !m_tightBounds && !m_orientedBounds;
+    if (cached)
+    {
+        PrepareFields(bbox_min, bbox_max, disp);
+    }
+    return cached;
+}
+
+void MarchingCube::samplePlaneRows(unsigned int i, unsigned int _firstRow, unsigned int _endRow, int meshNo, bool _static,
+                                   bool _cached, const float *_offsets, unsigned int _noLevels, float *const *o_planes)
+{
+    const unsigned int D = volume_depth;
+    std::vector<float> xs(D), ys(D), zs(D);
+    std::vector<float *> rows(_noLevels);
+    // each row passes its hints on to the next one
+    std::vector<unsigned int> hints(m_noDynamic + m_noStatic, mesh::c_noHint);
+    for (unsigned int j = _firstRow; j < _endRow; j++)
+    {
+        rowPositions(i, j, 0, D, xs.data(), ys.data(), zs.data());
+        for (unsigned int l = 0; l < _noLevels; l++)
+        {
+            rows[l] = o_planes[l] + j*D;
+        }
+
+        if (!_cached)
+        {
+            sampleRows(xs.data(), ys.data(), zs.data(), D, meshNo, _static, _offsets, _noLevels, rows.data(), hints.data());
+            continue;
+        }
 
-        else
+        const unsigned int row = voxelIndex(i, j, 0);
+        if (_static)
         {
-            m_staticObj[_id-1].load_from_file(_meshPath);
+            // static meshes are not offset
+            const float *field = &m_staticFields[meshNo-1][row];
+            for (unsigned int l = 0; l < _noLevels; l++)
+            {
+                std::copy(field, field + D, rows[l]);
+            }
+            continue;
         }
 
+        blendRows(xs.data(), ys.data(), zs.data(), D, meshNo, &m_dynFields[meshNo-1][row],
+                  [&](unsigned int _mesh, const unsigned int *_samples, unsigned int _count, float *o_distances)
+        {
+            const std::vector<float> &field = int(_mesh) < m_noDynamic ? m_dynFields[_mesh] : m_staticFields[_mesh - m_noDynamic];
+            for (unsigned int n = 0; n < _count; n++)
+            {
+                o_distances[n] = field[row + _samples[n]];
+            }
+        }, _offsets, _noLevels, rows.data());
     }
 }
 
-float MarchingCube::offsetMesh(glm::vec3 pos, int objNo)
+void MarchingCube::streamPlanes(int meshNo, bool _static, const float *_offsets, unsigned int _noLevels,
+                                std::vector<IndexedSweep> &o_sweeps, std::vector<std::vector<TRIANGLE>> &o_triangles)
 {
+    const unsigned int noLevels = _noLevels;
+    const bool cached = planeGrid(meshNo, _static);
 
-    float * src = NULL;
-    src = new float[m_noDynamic];
+    const unsigned int W = volume_width, H = volume_height, D = volume_depth;
+    const unsigned int planeSize = H*D;
 
-    float * ub = NULL;
-    ub = new float[m_noDynamic];
-
-    for(int i = 0; i<m_noDynamic; i++)
+    // the last four x planes of every level, enough for the gradients of indexedPlane
+    std::vector<float> ring(noLevels*4*planeSize);
+    auto plane = [&](unsigned int _level, unsigned int _i)
     {
-        src[i] = 0;
-        ub[i] = 0;
-    }
-
-    // Current Muscle
-    src[0] = m_dynObj[objNo-1](pos.x,pos.y,pos.z);
+        return &ring[(_level*4 + (_i & 3))*planeSize];
+    };
 
-    float localOffset = m_offset;
+    o_sweeps.assign(m_indexedOutput ? noLevels : 0, IndexedSweep());
+    o_triangles.assign(m_indexedOutput ? 0 : noLevels, std::vector<TRIANGLE>());
 
-    float t = fabs(pos.y - 6.0)*0.2;
-    if (t < 0.0) t = 0.0;
-    if (t > 1.0) t = 1.0;
-    localOffset = localOffset*(t*0.1 + (1.0-t));
+    // rows of a plane sampled by one task
+    const unsigned int blockRows = 8;
+    const unsigned int noBlocks = (H + blockRows - 1)/blockRows;
 
-    ub[0] = src[0]-localOffset;
-
-    //Alocate Muscle to variables, src[0] , must be current muscle
-    int j = 1;
-    for(int i = 0; i < m_noDynamic; i++)
+    // plane i is sampled while the levels extract plane i-2, which reads planes up to i
+    for (unsigned int i = 0; i < W + 2; i++)
     {
-        if( i != objNo-1)
+        if (i < W)
         {
-
-
-            src[j] = m_dynObj[i](pos.x,pos.y,pos.z);
-            ub[j] = src[j] - localOffset;
-            j++;
+            parallelFor(0, noBlocks, m_threadCount, [&](unsigned int b)
+            {
+                std::vector<float *> planes(noLevels);
+                for (unsigned int l = 0; l < noLevels; l++)
+                {
+                    planes[l] = plane(l, i);
+                }
+                samplePlaneRows(i, b*blockRows, std::min((b + 1)*blockRows, H), meshNo, _static, cached, _offsets,
+                                noLevels, planes.data());
+            });
         }
 
-    }
-
-    float dyn;
-    float oth;
-    float sta;
-    float bound;
+        if (i < 2)
+            continue;
 
-    float r = 0;
+        // each level only reads its own planes and writes its own mesh
+        const unsigned int step = i - 2;
+        parallelFor(0, noLevels, m_threadCount, [&](unsigned int l)
+        {
+            if (m_indexedOutput)
+            {
+                const float *planes[4];
+                for (unsigned int p = 0; p < 4; p++)
+                {
+                    const unsigned int index = step + p - 1;
+                    planes[p] = index < W ? plane(l, index) : nullptr;
+                }
+                indexedPlane(o_sweeps[l], step, planes);
+            }
+            else if (step > 0)
+            {
+                marchSlab(step - 1, plane(l, step - 1), plane(l, step), o_triangles[l]);
+            }
+        });
+    }
+}
 
-    // formula based on number of dynamic input
-    switch (m_noDynamic) {
-    case 1:
+void MarchingCube::pipelinePlanes(int meshNo, bool _static, std::vector<TRIANGLE> &o_triangles)
+{
+    const bool cached = planeGrid(meshNo, _static);
+    const unsigned int W = volume_width, H = volume_height, D = volume_depth;
+    const unsigned int planeSize = H*D;
+    if (W < 2)
+        return;
+
+    // Plane i is sampled into slot i % noSlots, there is room for every thread to sample a plane while others wait
+    // for their neighbour to be extracted
+    const unsigned int noThreads = resolveThreadCount(m_threadCount);
+    const unsigned int noSlots = 2*noThreads + 2;
+    std::vector<float> ring(noSlots*planeSize);
+    auto slot = [&](unsigned int _i)
+    {
+        return &ring[(_i % noSlots)*planeSize];
+    };
+
+    // sampled planes waiting for an extractor, never more than there are slots
+    BoundedQueue<unsigned int> sampled(noSlots);
+    // planes of each slab taken from the queue, the thread taking the second one extracts the slab
+    std::unique_ptr<std::atomic<unsigned int>[]> slabPlanes(new std::atomic<unsigned int>[W - 1]);
+    // slabs done with each plane, its slot can be sampled into again once both are
+    std::unique_ptr<std::atomic<unsigned int>[]> planeReaders(new std::atomic<unsigned int>[W]);
+    std::unique_ptr<std::atomic<bool>[]> slabDone(new std::atomic<bool>[W - 1]);
+    for (unsigned int c = 0; c + 1 < W; c++)
+    {
+        slabPlanes[c] = 0;
+        slabDone[c] = false;
+    }
+    for (unsigned int i = 0; i < W; i++)
+    {
+        planeReaders[i] = (i > 0 ? 1 : 0) + (i + 1 < W ? 1 : 0);
+    }
 
+    std::atomic<unsigned int> nextPlane(0);
+    std::atomic<unsigned int> slabsLeft(W - 1);
+    std::vector<std::vector<TRIANGLE>> slabTriangles(W - 1);
 
-        if (m_noStatic == 0)
+    // slabs join the output in order, by whichever thread gets the append flag when the next one is done
+    std::atomic<bool> appending(false);
+    unsigned int appended = 0;
+    auto append = [&]()
+    {
+        if (appending.exchange(true, std::memory_order_acquire))
+            return;
+        for (; appended + 1 < W && slabDone[appended].load(std::memory_order_acquire); appended++)
         {
-            return src[0] - localOffset;
+            o_triangles.insert(o_triangles.end(), slabTriangles[appended].begin(), slabTriangles[appended].end());
+            std::vector<TRIANGLE>().swap(slabTriangles[appended]);
         }
-        else
-        {
-            sta = m_staticObj[0](pos.x,pos.y,pos.z);
-            dyn = (ub[0]-sta);
-            bound = glm::max(glm::min(dyn,src[0]),-sta);
+        appending.store(false, std::memory_order_release);
+    };
 
-            if(bound <0.0)
+    auto sample = [&]()
+    {
+        unsigned int i = nextPlane.load();
+        while (i < W)
+        {
+            // the slot still holds plane i - noSlots until both its slabs are extracted
+            if (i >= noSlots && planeReaders[i - noSlots].load() != 0)
+                return false;
+            if (nextPlane.compare_exchange_weak(i, i + 1))
             {
-                float fa = abs(bound/0.1);
-                r = fa/(fa + 1.0);
+                float *plane = slot(i);
+                samplePlaneRows(i, 0, H, meshNo, _static, cached, &m_offset, 1, &plane);
+                while (!sampled.push(i))
+                    std::this_thread::yield();
+                return true;
             }
-
-            return src[0] - (localOffset*r);
         }
+        return false;
+    };
 
-
-
-        break;
-
-    case 2:
-
-
-        dyn = (ub[0]-ub[1]);
-        oth = src[1];
-        sta = m_staticObj[0](pos.x,pos.y,pos.z);
-
-        if (m_noStatic == 0)
+    auto extract = [&](unsigned int _plane)
+    {
+        const unsigned int first = _plane > 0 ? _plane - 1 : 0;
+        const unsigned int last = std::min(_plane, W - 2);
+        for (unsigned int c = first; c <= last; c++)
         {
-
-            bound = glm::max(glm::min(dyn,src[0]),-oth);
+            if (slabPlanes[c].fetch_add(1) != 1)
+                continue;
+            marchSlab(c, slot(c), slot(c + 1), slabTriangles[c]);
+            slabDone[c].store(true, std::memory_order_release);
+            planeReaders[c]--;
+            planeReaders[c + 1]--;
+            slabsLeft--;
         }
-        else
+        append();
+    };
+
+    // every thread extracts what is ready first and samples otherwise, so the stages overlap on any number of
+    // threads and a single thread never waits on itself
+    auto worker = [&]()
+    {
+        while (slabsLeft.load() > 0)
         {
-            bound = glm::max(glm::min(dyn,src[0]),-glm::min(oth,sta));
+            unsigned int plane;
+            if (sampled.pop(plane))
+                extract(plane);
+            else if (!sample())
+                std::this_thread::yield();
         }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < noThreads; t++)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
 
+    // the last slabs may have been done while another thread held the append flag
+    append();
+}
 
-        if(bound <0.0)
-        {
-            float fa = abs(bound/0.1);
-            r = fa/(fa + 1.0);
-        }
+void MarchingCube::polygonizeInto(int _level, int _slot, int modelNo, bool _static)
+{
+    if(m_octree)
+        PolygonizeOctree(modelNo, _static);
+    else
+        Polygonize(modelNo, _static);
 
-        return src[0] - (localOffset*r);
-        break;
-    case 3:
+    addOffsetLevels(_level + 1);
+    m_offsetArray[_level][_slot] = m_verts;
+    m_normalOffsetArray[_level][_slot] = m_vertsNormal;
+    m_indexOffsetArray[_level][_slot] = m_indices;
+
+    // clear m_verts after storing ready for next offset
+    m_verts.clear();
+    m_vertsNormal.clear();
+    m_indices.clear();
+}
 
 
 
+void MarchingCube::Polygonize(int modelNo, bool _static)
+{  
 
+    std::cout<<"Polygonizing object "<<modelNo<<"\n";
 
-        dyn = glm::max(ub[0]-ub[1], ub[0]-ub[2]);
-        oth = glm::min(src[1],src[2]);
-        sta = m_staticObj[0](pos.x,pos.y,pos.z);
+    if(m_pipelined && !m_indexedOutput)
+    {
+        delete [] volumeData;
+        volumeData = nullptr;
+        m_volume_size = 0;
+
+        std::vector<TRIANGLE> allTriangles;
+        pipelinePlanes(modelNo, _static, allTriangles);
+        m_nVerts = allTriangles.size()*3;
+        storeTriangles(allTriangles);
+        return;
+    }
 
-        if (m_noStatic == 0)
+    if(m_streamVolume || m_pipelined)
+    {
+        // only a ring of planes is kept, the dense volume is released
+        delete [] volumeData;
+        volumeData = nullptr;
+        m_volume_size = 0;
+
+        std::vector<IndexedSweep> sweeps;
+        std::vector<std::vector<TRIANGLE>> triangles;
+        streamPlanes(modelNo, _static, &m_offset, 1, sweeps, triangles);
+        if(m_indexedOutput)
         {
-           bound = glm::max(glm::min(dyn, src[0]), -oth);
+            finishIndexed(sweeps[0]);
         }
-
         else
-        {            
-            bound = glm::max(glm::min(dyn, src[0]), -glm::min(oth,sta));
+        {
+            m_nVerts = triangles[0].size()*3;
+            storeTriangles(triangles[0]);
         }
+        return;
+    }
 
+    // Prepare the implicit volume ready for marching cubes to be applied
+    PrepareVolume(modelNo, _static);
 
+    if(m_indexedOutput)
+    {
+        PolygonizeIndexed();
+        return;
+    }
 
-        if(bound <0.0)
-        {
-            float fa = abs(bound/0.1);
-            r = fa/(fa + 1.0);
-        }
+    std::vector<TRIANGLE> allTriangles;
 
-        return src[0] - (localOffset*r);
-        break;
+    auto march = [&](unsigned int i, unsigned int j, unsigned int k, std::vector<TRIANGLE> &o_triangles)
+    {
+        polygonizeCell(&volumeData[voxelIndex(i, 0, 0)], &volumeData[voxelIndex(i+1, 0, 0)], volume_depth,
+                       j*volume_depth + k, glm::vec3(i, j, k), o_triangles);
+    };
 
-    default:
-        break;
+    // Every slab or brick of cells fills its own list, the lists are merged in order afterwards so the triangles do
+    // not depend on the number of threads
+    if (m_mortonOrder)
+    {
+        // cells brick by brick along a Morton curve, the triangles come out in that order
+        const unsigned int brick = m_brickSize > 0 ? m_brickSize : 1;
+        const unsigned int cells[3] = {volume_width-1, volume_height-1, volume_depth-1};
+        const unsigned int noBricks[3] = {(cells[0] + brick - 1)/brick, (cells[1] + brick - 1)/brick, (cells[2] + brick - 1)/brick};
+        const std::vector<glm::uvec3> bricks = mortonBricks(noBricks);
+        std::vector<std::vector<TRIANGLE>> brickTriangles(bricks.size());
+        parallelFor(0, bricks.size(), m_threadCount, [&](unsigned int b)
+        {
+            const glm::uvec3 &lo = bricks[b];
+            const unsigned int hi[3] = {std::min((lo.x + 1)*brick, cells[0]), std::min((lo.y + 1)*brick, cells[1]), std::min((lo.z + 1)*brick, cells[2])};
+            for (unsigned int i = lo.x*brick; i < hi[0]; i++)
+                for (unsigned int j = lo.y*brick; j < hi[1]; j++)
+                    for (unsigned int k = lo.z*brick; k < hi[2]; k++)
+                        march(i, j, k, brickTriangles[b]);
+        });
+        mergeParts(brickTriangles, m_threadCount, allTriangles);
     }
+    else
+    {
+        std::vector<std::vector<TRIANGLE>> slabTriangles(volume_width-1);
+        parallelFor(0, volume_width-1, m_threadCount, [&](unsigned int i)
+        {
+            marchSlab(i, &volumeData[voxelIndex(i, 0, 0)], &volumeData[voxelIndex(i+1, 0, 0)], slabTriangles[i]);
+        });
+        mergeParts(slabTriangles, m_threadCount, allTriangles);
+    }
+    m_nVerts = allTriangles.size()*3;
 
-    delete src;
-    delete ub;
-
-    return NULL;
+    storeTriangles(allTriangles);
 
 }
 
-// Creates volume on grid from implicit function
-bool MarchingCube::PrepareVolume(int meshNo, bool _static)
+unsigned int MarchingCube::marchSlab(unsigned int i, const float *_plane0, const float *_plane1, std::vector<TRIANGLE> &o_triangles)
 {
+    const unsigned int H = volume_height, D = volume_depth;
+    // the signs of both planes, row j of plane p starts at word (p*H + j)*noWords. MarchingTriangles compares the
+    // values with the isolevel as a float
+    const unsigned int noWords = signMaskWords(D);
+    std::vector<uint64_t> masks(2*H*noWords);
+    std::vector<uint64_t> active(noWords);
+    for (unsigned int j = 0; j < H; j++)
+    {
+        signMaskRow(_plane0 + j*D, D, static_cast<float>(isolevel), &masks[j*noWords]);
+        signMaskRow(_plane1 + j*D, D, static_cast<float>(isolevel), &masks[(H + j)*noWords]);
+    }
+
+    unsigned int noTriangles = 0;
+    for (unsigned int j = 0; j + 1 < H; j++)
+    {
+        const uint64_t *rows[4] = {&masks[j*noWords], &masks[(j+1)*noWords], &masks[(H + j)*noWords], &masks[(H + j+1)*noWords]};
+        if (!activeCells(rows, D, &active[0]))
+            continue;
+
+        // only the crossed cells, in increasing k like a full scan of the row
+        for (unsigned int w = 0; w < noWords; w++)
+        {
+            for (uint64_t bits = active[w]; bits != 0; bits &= bits - 1)
+            {
+                const unsigned int k = w*64 + lowestBit(bits);
+                noTriangles += polygonizeCell(_plane0, _plane1, D, j*D + k, glm::vec3(i, j, k), o_triangles);
+            }
+        }
+    }
+    return noTriangles;
+}
 
-    // recommended 100 - 200
-    volume_width = 300;
-    volume_height =300;
-    volume_depth = 300;
+void MarchingCube::PolygonizeOctree(int modelNo, bool _static)
+{
+    std::cout<<"Polygonizing object "<<modelNo<<" with an octree\n";
 
-    m_volume_size = volume_width*volume_height*volume_depth;
+    float bbox_min[3], bbox_max[3], disp[3];
+    unsigned int samples[3];
+    glm::vec3 axes[3];
+    samplingGrid(modelNo, _static, m_octreeResolution, bbox_min, bbox_max, disp, samples, axes);
 
-    volumeData = new float[m_volume_size];
+    // no volume is allocated, the dimensions are only used to rescale the vertices
+    volume_width = samples[0];
+    volume_height = samples[1];
+    volume_depth = samples[2];
 
-    float bbox_min[3], bbox_max[3]; //bounding box
-    bbox_min[0] = -20;
-    bbox_min[1] = -20;
-    bbox_min[2] = -20;
-    bbox_max[0] = 20;
-    bbox_max[1] = 20;
-    bbox_max[2] = 20;
+    setGrid(bbox_min, disp, axes);
 
-    float dims[3], disp[3];
+    const mesh &obj = _static ? m_staticObj[modelNo-1] : m_dynObj[modelNo-1];
+    const float maxOffset = _static ? 0.0f : fabs(m_offset);
+    const unsigned int leafSize = m_brickSize > 0 ? m_brickSize : 1;
+    const unsigned int noCells[3] = {samples[0] - 1, samples[1] - 1, samples[2] - 1};
 
-    // find dimensions of bounding box eg width, height, depth
-    for (int n = 0; n < 3; n++)
+    unsigned int rootSize = leafSize;
+    while (rootSize < std::max(noCells[0], std::max(noCells[1], noCells[2])))
     {
-        dims[n] = bbox_max[n]-bbox_min[n];
+        rootSize *= 2;
     }
-    // find dispacement, eg bounding box width divided by volume width ( 0-1)
-    disp[0] = dims[0]/static_cast<float>(volume_width);
-    disp[1] = dims[1]/static_cast<float>(volume_height);
-    disp[2] = dims[2]/static_cast<float>(volume_depth);
 
+    struct Octant
+    {
+        unsigned int origin[3];
+        unsigned int size;
+    };
+
+    // Depth first walk collecting the leaves that may contain the surface. A cell only produces triangles if
+    // its field crosses isolevel somewhere inside it, where the mesh distance is within |isolevel| + maxOffset,
+    // so an octant whose centre is further than that plus its half diagonal has nothing to extract.
+    std::vector<Octant> leaves;
+    std::vector<Octant> stack;
+    stack.push_back({{0, 0, 0}, rootSize});
+    while (!stack.empty())
+    {
+        Octant octant = stack.back();
+        stack.pop_back();
 
+        glm::vec3 centre, halfExtent;
+        bool empty = false;
+        for (int n = 0; n < 3; n++)
+        {
+            unsigned int last = std::min(octant.origin[n] + octant.size, noCells[n]);
+            empty |= octant.origin[n] >= last;
+            float first = bbox_min[n] + disp[n]*static_cast<float>(octant.origin[n]);
+            float end = bbox_min[n] + disp[n]*static_cast<float>(last);
+            centre[n] = 0.5f*(first + end);
+            halfExtent[n] = 0.5f*(end - first);
+        }
+        if (empty)
+            continue;
+        centre = gridToWorld(centre);
 
+        const float radius = glm::length(halfExtent) + fabs(isolevel) + maxOffset;
+        float distance;
+        if (!obj(centre.x, centre.y, centre.z, radius, &distance))
+            continue;
 
-    for (uint i = 0; i < volume_width; i++)
-    {
-        float x = bbox_min[0] + disp[0]*static_cast<float>(i);
-        for (uint j = 0; j < volume_height; j++)
+        if (octant.size <= leafSize)
         {
-            float y = bbox_min[1] + disp[1]*static_cast<float>(j);
-            for (uint k = 0; k < volume_depth; k++)
-            {
-                float z = bbox_min[2] + disp[2]*static_cast<float>(k);
+            leaves.push_back(octant);
+            continue;
+        }
 
-                float value;
-                glm::vec3 pos = {x,y,z};             
+        // pushed in reverse so children are visited, and leaves stored, in a fixed order
+        const unsigned int half = octant.size/2;
+        for (int child = 7; child >= 0; child--)
+        {
+            Octant sub = {{octant.origin[0] + ((child & 1) ? half : 0),
+                           octant.origin[1] + ((child & 2) ? half : 0),
+                           octant.origin[2] + ((child & 4) ? half : 0)}, half};
+            stack.push_back(sub);
+        }
+    }
 
+    std::cout<<"Octree kept "<<leaves.size()<<" leaves of "<<leafSize<<"^3 cells\n";
 
-                if(_static == false)
-                {
-                    value = offsetMesh(pos, meshNo);
-                }
-                else
-                {
+    // leaves are sampled and polygonized independently, each into its own list so the order stays fixed
+    std::vector<std::vector<TRIANGLE>> leafTriangles(leaves.size());
+    parallelFor(0, leaves.size(), m_threadCount, [&](unsigned int l)
+    {
+        const Octant &leaf = leaves[l];
+        unsigned int dims[3];
+        for (int n = 0; n < 3; n++)
+        {
+            dims[n] = std::min(leaf.origin[n] + leaf.size, noCells[n]) - leaf.origin[n] + 1;
+        }
 
-                    value = m_staticObj[meshNo-1](x,y,z);
-                }
+        // corner values of the leaf, sampled at exactly the positions PrepareVolume would use
+        std::vector<float> values(dims[0]*dims[1]*dims[2]);
+        std::vector<float> xs(dims[2]), ys(dims[2]), zs(dims[2]);
+        std::vector<unsigned int> hints(m_noDynamic + m_noStatic, mesh::c_noHint);
+        for (unsigned int i = 0; i < dims[0]; i++)
+        {
+            for (unsigned int j = 0; j < dims[1]; j++)
+            {
+                rowPositions(leaf.origin[0] + i, leaf.origin[1] + j, leaf.origin[2], dims[2], xs.data(), ys.data(), zs.data());
+                sampleRow(xs.data(), ys.data(), zs.data(), dims[2], modelNo, _static, &values[(i*dims[1] + j)*dims[2]], hints.data());
+            }
+        }
 
-                volumeData[i*volume_width*volume_height + j*volume_width + k] = value;
+        const unsigned int planeSize = dims[1]*dims[2];
+        for (unsigned int i = 0; i + 1 < dims[0]; i++)
+        {
+            for (unsigned int j = 0; j + 1 < dims[1]; j++)
+            {
+                for (unsigned int k = 0; k + 1 < dims[2]; k++)
+                {
+                    const glm::vec3 origin(leaf.origin[0] + i, leaf.origin[1] + j, leaf.origin[2] + k);
+                    polygonizeCell(&values[i*planeSize], &values[(i+1)*planeSize], dims[2], j*dims[2] + k, origin,
+                                   leafTriangles[l]);
+                }
             }
         }
-    }
-     return true;
+    });
+
+    std::vector<TRIANGLE> allTriangles;
+    mergeParts(leafTriangles, m_threadCount, allTriangles);
+    m_nVerts = allTriangles.size()*3;
+
+    storeTriangles(allTriangles);
 }
 
-void MarchingCube::run()
+// Packs triangles in volume coordinates into m_verts and m_vertsNormal, see outputPosition
+void MarchingCube::storeTriangles(std::vector<TRIANGLE> &allTriangles)
 {
-    int noOffsetLevels = 1;
-
-    // for each offset level
-    for( int i = 0; i<noOffsetLevels; i++)
+    // each triangle fills its own nine floats, so blocks of triangles are packed in parallel
+    const size_t noTriangles = allTriangles.size();
+    const size_t firstVertex = m_verts.size();
+    const size_t firstNormal = m_vertsNormal.size();
+    m_verts.resize(firstVertex + noTriangles*9);
+    m_vertsNormal.resize(firstNormal + noTriangles*9);
+
+    const unsigned int blockSize = 4096;
+    const unsigned int noBlocks = (noTriangles + blockSize - 1)/blockSize;
+    parallelFor(0, noBlocks, m_threadCount, [&](unsigned int b)
     {
-        m_offset = float(0.3);
-
+        const size_t end = std::min(noTriangles, static_cast<size_t>(b + 1)*blockSize);
+        for (size_t t = static_cast<size_t>(b)*blockSize; t < end; t++)
+        {
+            // one normal for all three vertices in the triangle
+            const glm::vec3 normal = outputNormal(computeTriangleNormal(allTriangles[t]));
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                const glm::vec3 position = outputPosition(allTriangles[t].p[i]);
+                float *vertex = &m_verts[firstVertex + (t*3 + i)*3];
+                vertex[0] = position.x;
+                vertex[1] = position.y;
+                vertex[2] = position.z;
+                float *vertexNormal = &m_vertsNormal[firstNormal + (t*3 + i)*3];
+                vertexNormal[0] = normal.x;
+                vertexNormal[1] = normal.y;
+                vertexNormal[2] = normal.z;
+            }
+        }
+    });
 
-        std::cout<<"Polygonizing dynamic "<<"\n";
-        for(int j = 1; j<= m_noDynamic; j++)
+    // the octree has no shared vertices, index the soup so indexed rendering still works
+    if(m_indexedOutput)
+    {
+        for(size_t i = 0; i < noTriangles*3; ++i)
         {
-            Polygonize(j, false);
+            m_indices.push_back(i);
+        }
+    }
+
+    allTriangles.clear();
+}
 
-            m_offsetArray[i][j-1] = m_verts;
-            m_normalOffsetArray[i][j-1] = m_vertsNormal;
 
-            // clear m_verts after storing ready for next offset
-            m_verts.clear();
-            m_vertsNormal.clear();
+void MarchingCube::PolygonizeIndexed()
+{
+    const unsigned int W = volume_width, H = volume_height;
+    if (W == 0 || H == 0 || volume_depth == 0)
+    {
+        IndexedSweep empty;
+        finishIndexed(empty);
+        return;
+    }
 
+    auto planesAround = [&](unsigned int i, const float **o_planes)
+    {
+        for (unsigned int p = 0; p < 4; p++)
+        {
+            // plane i-1+p, the unsigned wrap of plane -1 is outside too
+            const unsigned int plane = i + p - 1;
+            o_planes[p] = plane < W ? &volumeData[voxelIndex(plane, 0, 0)] : nullptr;
         }
-        std::cout<<"Polygonizing static "<<"\n";
-        for(int k = 1; k<= m_noStatic; k++)
+    };
+
+    // The x planes are split into runs swept in parallel like indexedPlane, so the vertices, normals and ids of every
+    // plane are found once and the ids kept for two planes. The ids of a run start at 0 and the ids of its first
+    // plane are kept aside, once the runs are done and their first vertex known the ids are offset and the slabs
+    // between two runs triangulated. Vertices and slabs come out in x order so the mesh is the same whatever the
+    // number of threads
+    const unsigned int noRuns = std::min(W, 4*resolveThreadCount(m_threadCount));
+    std::vector<IndexedSweep> runs(noRuns);
+    std::vector<std::vector<unsigned int>> runFirstIds(noRuns);
+    auto runBegin = [&](unsigned int r)
+    {
+        return static_cast<unsigned int>(static_cast<unsigned long long>(W)*r/noRuns);
+    };
+    parallelFor(0, noRuns, m_threadCount, [&](unsigned int r)
+    {
+        IndexedSweep &run = runs[r];
+        run.firstPlane = runBegin(r);
+        for (unsigned int i = run.firstPlane; i < runBegin(r + 1); i++)
         {
-            Polygonize(k, true);
-
-            m_offsetArray[i][m_noDynamic + (k-1)] = m_verts;
-            m_normalOffsetArray[i][m_noDynamic + (k-1)] = m_vertsNormal;
-
-            // clear m_verts after storing ready for next offset
-            m_verts.clear();
-            m_vertsNormal.clear();
+            const float *planes[4];
+            planesAround(i, planes);
+            indexedPlane(run, i, planes);
         }
+        if (r > 0)
+            runFirstIds[r] = run.edgeIds[run.firstPlane & 1];
+    });
 
-
-
-
-        std::cout<<"Offset saved for offset "<<m_offset<<"\n";
+    std::vector<unsigned int> firstVertex(noRuns + 1, 0);
+    for (unsigned int r = 0; r < noRuns; r++)
+    {
+        firstVertex[r + 1] = firstVertex[r] + runs[r].positions.size();
     }
 
-}
-
+    // the indices of run r then those of the slab between runs r and r+1
+    std::vector<std::vector<unsigned int>> indexParts(2*noRuns - 1);
+    parallelFor(0, noRuns, m_threadCount, [&](unsigned int r)
+    {
+        IndexedSweep &run = runs[r];
+        for (unsigned int &index : run.indices)
+        {
+            index += firstVertex[r];
+        }
+        indexParts[2*r].swap(run.indices);
+        if (r + 1 == noRuns)
+            return;
+
+        // ids left unset by planeVertices wrap around, they are not read
+        const unsigned int last = runBegin(r + 1) - 1;
+        std::vector<unsigned int> &ids0 = run.edgeIds[last & 1];
+        std::vector<unsigned int> &ids1 = runFirstIds[r + 1];
+        for (unsigned int &id : ids0)
+        {
+            id += firstVertex[r];
+        }
+        for (unsigned int &id : ids1)
+        {
+            id += firstVertex[r + 1];
+        }
+        const float *planes[4];
+        planesAround(last, planes);
+        slabTriangles(last, planes[1], planes[2], &ids0[0], &ids1[0], indexParts[2*r + 1]);
+        std::vector<unsigned int>().swap(ids1);
+    });
+
+    std::vector<std::vector<glm::vec3>> positionParts(noRuns), normalParts(noRuns);
+    for (unsigned int r = 0; r < noRuns; r++)
+    {
+        positionParts[r].swap(runs[r].positions);
+        normalParts[r].swap(runs[r].normals);
+    }
+    runs.clear();
 
+    IndexedSweep sweep;
+    mergeParts(positionParts, m_threadCount, sweep.positions);
+    mergeParts(normalParts, m_threadCount, sweep.normals);
+    mergeParts(indexParts, m_threadCount, sweep.indices);
 
-void MarchingCube::Polygonize(int modelNo, bool _static)
-{  
+    finishIndexed(sweep);
+}
 
-    std::cout<<"Polygonizing object "<<modelNo<<"\n";
+void MarchingCube::indexedPlane(IndexedSweep &io_sweep, unsigned int i, const float *const *_planes)
+{
+    const unsigned int H = volume_height, D = volume_depth;
+    if (io_sweep.edgeIds[0].empty())
+    {
+        io_sweep.edgeIds[0].resize(H*D*3);
+        io_sweep.edgeIds[1].resize(H*D*3);
+    }
 
-    // Prepare the implicit volume ready for marching cubes to be applied
-    PrepareVolume(modelNo, _static);
+    planeVertices(io_sweep, i, _planes);
 
-    VertData    d;
-    GRIDCELL       grid;
-    std::vector<TRIANGLE> allTriangles;
-    unsigned int    i,j,k, n;
+    // the cells between planes i-1 and i, all their edges have a vertex id by now
+    if (i > io_sweep.firstPlane)
+        slabTriangles(i - 1, _planes[0], _planes[1], &io_sweep.edgeIds[(i - 1) & 1][0], &io_sweep.edgeIds[i & 1][0],
+                      io_sweep.indices);
+}
 
-    m_nVerts = 0;
+void MarchingCube::planeVertices(IndexedSweep &io_sweep, unsigned int i, const float *const *_planes)
+{
+    const unsigned int W = volume_width, H = volume_height, D = volume_depth;
+    // _planes starts at plane i-1
+    auto value = [&](unsigned int _i, unsigned int _j, unsigned int _k)
+    {
+        return _planes[_i + 1 - i][_j*D + _k];
+    };
 
-    for (i=0;i<volume_depth-1;i++)
+    // central differences of the volume, one sided on its faces
+    auto gradient = [&](unsigned int i, unsigned int j, unsigned int k)
+    {
+        const unsigned int i0 = i > 0 ? i-1 : i, i1 = i+1 < W ? i+1 : i;
+        const unsigned int j0 = j > 0 ? j-1 : j, j1 = j+1 < H ? j+1 : j;
+        const unsigned int k0 = k > 0 ? k-1 : k, k1 = k+1 < D ? k+1 : k;
+        return glm::vec3((value(i1,j,k) - value(i0,j,k))/static_cast<float>(i1 - i0),
+                         (value(i,j1,k) - value(i,j0,k))/static_cast<float>(j1 - j0),
+                         (value(i,j,k1) - value(i,j,k0))/static_cast<float>(k1 - k0));
+    };
+
+    // Plane i owns its x edges towards plane i+1 and its y and z edges, so every edge gets exactly one vertex.
+    std::vector<glm::vec3> &positions = io_sweep.positions;
+    std::vector<glm::vec3> &normals = io_sweep.normals;
+    unsigned int *ids = &io_sweep.edgeIds[i & 1][0];
+    for (unsigned int j = 0; j < H; j++)
     {
-        for (j=0;j<volume_height-1;j++)
+        for (unsigned int k = 0; k < D; k++)
         {
-            for (k=0;k<volume_width-1;k++)
+            const float v0 = value(i,j,k);
+            const glm::vec3 p0(i,j,k);
+            const bool inside = v0 < isolevel;
+            const bool hasNext[3] = {i+1 < W, j+1 < H, k+1 < D};
+            for (unsigned int axis = 0; axis < 3; axis++)
             {
-
-                grid.p[0].x = i;
-                grid.p[0].y = j;
-                grid.p[0].z = k;
-                grid.val[0] = volumeData[i*volume_width*volume_height + j*volume_width + k];
-                grid.p[1].x = i+1;
-                grid.p[1].y = j;
-                grid.p[1].z = k;
-                grid.val[1] = volumeData[(i+1)*volume_width*volume_height + j*volume_width + k];
-                grid.p[2].x = i+1;
-                grid.p[2].y = j+1;
-                grid.p[2].z = k;
-                grid.val[2] = volumeData[(i+1)*volume_width*volume_height + (j+1)*volume_width + k];
-                grid.p[3].x = i;
-                grid.p[3].y = j+1;
-                grid.p[3].z = k;
-                grid.val[3] = volumeData[i*volume_width*volume_height + (j+1)*volume_width + k];
-                grid.p[4].x = i;
-                grid.p[4].y = j;
-                grid.p[4].z = k+1;
-                grid.val[4] = volumeData[i*volume_width*volume_height + j*volume_width + k+1];
-                grid.p[5].x = i+1;
-                grid.p[5].y = j;
-                grid.p[5].z = k+1;
-                grid.val[5] = volumeData[(i+1)*volume_width*volume_height + j*volume_width + k+1];
-                grid.p[6].x = i+1;
-                grid.p[6].y = j+1;
-                grid.p[6].z = k+1;
-                grid.val[6] = volumeData[(i+1)*volume_width*volume_height + (j+1)*volume_width + k+1];
-                grid.p[7].x = i;
-                grid.p[7].y = j+1;
-                grid.p[7].z = k+1;
-                grid.val[7] = volumeData[i*volume_width*volume_height + (j+1)*volume_width + k+1];
-                n = MarchingTriangles(grid, isolevel, allTriangles);
-                m_nVerts += n*3;
+                if (!hasNext[axis])
+                    continue;
+                const float v1 = value(i + (axis == 0), j + (axis == 1), k + (axis == 2));
+                if ((v1 < isolevel) == inside)
+                    continue;
+                ids[(j*D + k)*3 + axis] = positions.size();
+                glm::vec3 p1 = p0;
+                p1[axis] += 1.0f;
+                positions.push_back(VertexInterp(isolevel, p0, p1, v0, v1));
+
+                if (m_gradientNormals)
+                {
+                    // interpolate the gradient like VertexInterp, negated to face the same way as the triangle
+                    // winding from c_cellTriangles, which points down the field
+                    float mu = 0.0f;
+                    if (fabs(isolevel-v1) < 0.00001)
+                        mu = 1.0f;
+                    else if (fabs(isolevel-v0) >= 0.00001 && fabs(v0-v1) >= 0.00001)
+                        mu = (isolevel - v0) / (v1 - v0);
+                    glm::vec3 g0 = gradient(i, j, k);
+                    glm::vec3 g1 = gradient(i + (axis == 0), j + (axis == 1), k + (axis == 2));
+                    normals.push_back(-(g0 + mu*(g1 - g0)));
+                }
             }
         }
     }
+}
 
-    std::vector<TRIANGLE>::iterator itr;
-
-    for(itr=allTriangles.begin();itr!=allTriangles.end();++itr)
+void MarchingCube::slabTriangles(unsigned int c, const float *_plane0, const float *_plane1, const unsigned int *_ids0,
+                                 const unsigned int *_ids1, std::vector<unsigned int> &o_indices)
+{
+    const unsigned int H = volume_height, D = volume_depth;
+    const float *planes[2] = {_plane0, _plane1};
+    const unsigned int *ids[2] = {_ids0, _ids1};
+    auto value = [&](unsigned int _i, unsigned int _j, unsigned int _k)
     {
-        // two ways to compute the normal, 1. one normal per triangle; 2. each vertex got seperate normal
-        m_triNormal = computeTriangleNormal(*itr);
-        for(i=0;i<3;i++)
+        return planes[_i - c][_j*D + _k];
+    };
+
+    // skip the rows of cells, then the cells, with all corners on one side
+    const unsigned int noWords = signMaskWords(D);
+    const float iso = signMaskThreshold(isolevel);
+    std::vector<uint64_t> masks(4*noWords);
+    std::vector<uint64_t> active(noWords);
+    signMaskRow(_plane0, D, iso, &masks[0]);
+    signMaskRow(_plane1, D, iso, &masks[noWords]);
+    for (unsigned int j = 0; j + 1 < H; j++)
+    {
+        // rows j of both planes are in slots j&1, rows j+1 go in the other two
+        const unsigned int next = (j + 1) & 1;
+        signMaskRow(_plane0 + (j+1)*D, D, iso, &masks[(2*next)*noWords]);
+        signMaskRow(_plane1 + (j+1)*D, D, iso, &masks[(2*next + 1)*noWords]);
+        const uint64_t *rows[4] = {&masks[0], &masks[noWords], &masks[2*noWords], &masks[3*noWords]};
+        if (!activeCells(rows, D, &active[0]))
+            continue;
+
+        for (unsigned int w = 0; w < noWords; w++)
         {
-            // pack in the vertex data first
-            d.x=itr->p[i].x/volume_depth*2.0-1.0;
-            d.y=itr->p[i].y/volume_height*2.0-1.0;
-            d.z=itr->p[i].z/volume_width*2.0-1.0;
-            // one normal for all three vertices in the triangle
-            d.nx = m_triNormal.x;
-            d.ny = m_triNormal.y;
-            d.nz = m_triNormal.z;
-            // put d vector intoo m_vboMesh
-            m_vboMesh.push_back(d);
-
+            for (uint64_t bits = active[w]; bits != 0; bits &= bits - 1)
+            {
+                const unsigned int k = w*64 + lowestBit(bits);
+                int cubeindex = 0;
+                if (value(c  ,j  ,k  ) < isolevel) cubeindex |= 1;
+                if (value(c+1,j  ,k  ) < isolevel) cubeindex |= 2;
+                if (value(c+1,j+1,k  ) < isolevel) cubeindex |= 4;
+                if (value(c  ,j+1,k  ) < isolevel) cubeindex |= 8;
+                if (value(c  ,j  ,k+1) < isolevel) cubeindex |= 16;
+                if (value(c+1,j  ,k+1) < isolevel) cubeindex |= 32;
+                if (value(c+1,j+1,k+1) < isolevel) cubeindex |= 64;
+                if (value(c  ,j+1,k+1) < isolevel) cubeindex |= 128;
+
+                if (c_cellEdgeMask[cubeindex] == 0)
+                    continue;
+
+                for (int t = 0; c_cellTriangles[cubeindex][t] != -1; t++)
+                {
+                    const uint8_t *edge = c_cellEdges[c_cellTriangles[cubeindex][t]];
+                    o_indices.push_back(ids[edge[0]][((j + edge[1])*D + k + edge[2])*3 + edge[3]]);
+                }
+            }
         }
-
     }
+}
+
+void MarchingCube::finishIndexed(IndexedSweep &io_sweep)
+{
+    const std::vector<glm::vec3> &positions = io_sweep.positions;
+    std::vector<glm::vec3> &normals = io_sweep.normals;
+    const std::vector<unsigned int> &indices = io_sweep.indices;
 
-        for(uint i =0; i < m_vboMesh.size(); ++i )
+    // without gradients, every face adds its area weighted normal to its three vertices
+    if (!m_gradientNormals)
+    {
+        normals.assign(positions.size(), glm::vec3(0.0f));
+        for (size_t t = 0; t < indices.size(); t += 3)
         {
-           m_verts.push_back(m_vboMesh[i].x);
-           m_verts.push_back(m_vboMesh[i].y);
-           m_verts.push_back(m_vboMesh[i].z);
-           //std::cout << i <<'\n';
+            const glm::vec3 &a = positions[indices[t]];
+            glm::vec3 n = glm::cross(positions[indices[t+1]] - a, positions[indices[t+2]] - a);
+            normals[indices[t]] += n;
+            normals[indices[t+1]] += n;
+            normals[indices[t+2]] += n;
         }
+    }
 
+    // every vertex fills its own three floats, so blocks of vertices are packed in parallel
+    m_nVerts = positions.size();
+    const size_t firstVertex = m_verts.size();
+    const size_t firstNormal = m_vertsNormal.size();
+    m_verts.resize(firstVertex + positions.size()*3);
+    m_vertsNormal.resize(firstNormal + positions.size()*3);
 
-        for(uint i =0; i < m_vboMesh.size(); ++i )
+    const unsigned int blockSize = 4096;
+    const unsigned int noBlocks = (positions.size() + blockSize - 1)/blockSize;
+    parallelFor(0, noBlocks, m_threadCount, [&](unsigned int b)
+    {
+        const size_t end = std::min(positions.size(), static_cast<size_t>(b + 1)*blockSize);
+        for (size_t v = static_cast<size_t>(b)*blockSize; v < end; v++)
         {
-            m_vertsNormal.push_back(m_vboMesh[i].nx);
-            m_vertsNormal.push_back(m_vboMesh[i].ny);
-            m_vertsNormal.push_back(m_vboMesh[i].nz);
-
-
+            const glm::vec3 position = outputPosition(positions[v]);
+            m_verts[firstVertex + v*3] = position.x;
+            m_verts[firstVertex + v*3 + 1] = position.y;
+            m_verts[firstVertex + v*3 + 2] = position.z;
+
+            glm::vec3 n = outputNormal(normals[v]);
+            if (glm::dot(n, n) > 0.0f)
+                n = glm::normalize(n);
+            m_vertsNormal[firstNormal + v*3] = n.x;
+            m_vertsNormal[firstNormal + v*3 + 1] = n.y;
+            m_vertsNormal[firstNormal + v*3 + 2] = n.z;
         }
-
-        // clear vbo ready for next object
-        m_vboMesh.clear();
-
-
-    allTriangles.erase(allTriangles.begin(), allTriangles.end());
-
+    });
+    m_indices = indices;
 }
 
-
 // Modified from the code at http://paulbourke.net/geometry/polygonise/
 
 /*-------------------------------------------------------------------------
@@ -421,386 +2005,35 @@ void MarchingCube::Polygonize(int modelNo, bool _static)
 */
 unsigned int MarchingCube::MarchingTriangles(GRIDCELL g, float iso, std::vector<TRIANGLE> &triList)
 {
-
-    static int edgeTable[256]={
-    0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
-    0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
-    0x190, 0x99 , 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
-    0x99c, 0x895, 0xb9f, 0xa96, 0xd9a, 0xc93, 0xf99, 0xe90,
-    0x230, 0x339, 0x33 , 0x13a, 0x636, 0x73f, 0x435, 0x53c,
-    0xa3c, 0xb35, 0x83f, 0x936, 0xe3a, 0xf33, 0xc39, 0xd30,
-    0x3a0, 0x2a9, 0x1a3, 0xaa , 0x7a6, 0x6af, 0x5a5, 0x4ac,
-    0xbac, 0xaa5, 0x9af, 0x8a6, 0xfaa, 0xea3, 0xda9, 0xca0,
-    0x460, 0x569, 0x663, 0x76a, 0x66 , 0x16f, 0x265, 0x36c,
-    0xc6c, 0xd65, 0xe6f, 0xf66, 0x86a, 0x963, 0xa69, 0xb60,
-    0x5f0, 0x4f9, 0x7f3, 0x6fa, 0x1f6, 0xff , 0x3f5, 0x2fc,
-    0xdfc, 0xcf5, 0xfff, 0xef6, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
-    0x650, 0x759, 0x453, 0x55a, 0x256, 0x35f, 0x55 , 0x15c,
-    0xe5c, 0xf55, 0xc5f, 0xd56, 0xa5a, 0xb53, 0x859, 0x950,
-    0x7c0, 0x6c9, 0x5c3, 0x4ca, 0x3c6, 0x2cf, 0x1c5, 0xcc ,
-    0xfcc, 0xec5, 0xdcf, 0xcc6, 0xbca, 0xac3, 0x9c9, 0x8c0,
-    0x8c0, 0x9c9, 0xac3, 0xbca, 0xcc6, 0xdcf, 0xec5, 0xfcc,
-    0xcc , 0x1c5, 0x2cf, 0x3c6, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
-    0x950, 0x859, 0xb53, 0xa5a, 0xd56, 0xc5f, 0xf55, 0xe5c,
-    0x15c, 0x55 , 0x35f, 0x256, 0x55a, 0x453, 0x759, 0x650,
-    0xaf0, 0xbf9, 0x8f3, 0x9fa, 0xef6, 0xfff, 0xcf5, 0xdfc,
-    0x2fc, 0x3f5, 0xff , 0x1f6, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
-    0xb60, 0xa69, 0x963, 0x86a, 0xf66, 0xe6f, 0xd65, 0xc6c,
-    0x36c, 0x265, 0x16f, 0x66 , 0x76a, 0x663, 0x569, 0x460,
-    0xca0, 0xda9, 0xea3, 0xfaa, 0x8a6, 0x9af, 0xaa5, 0xbac,
-    0x4ac, 0x5a5, 0x6af, 0x7a6, 0xaa , 0x1a3, 0x2a9, 0x3a0,
-    0xd30, 0xc39, 0xf33, 0xe3a, 0x936, 0x83f, 0xb35, 0xa3c,
-    0x53c, 0x435, 0x73f, 0x636, 0x13a, 0x33 , 0x339, 0x230,
-    0xe90, 0xf99, 0xc93, 0xd9a, 0xa96, 0xb9f, 0x895, 0x99c,
-    0x69c, 0x795, 0x49f, 0x596, 0x29a, 0x393, 0x99 , 0x190,
-    0xf00, 0xe09, 0xd03, 0xc0a, 0xb06, 0xa0f, 0x905, 0x80c,
-    0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x0   };
-
-    /*
-       int triTable[256][16] also corresponds to the 256 possible combinations
-       of vertices.
-       The [16] dimension of the table is again the list of edges of the cube
-       which are intersected by the surface.  This time however, the edges are
-       enumerated in the order of the vertices making up the triangle mesh of
-       the surface.  Each edge contains one vertex that is on the surface.
-       Each triple of edges listed in the table contains the vertices of one
-       triangle on the mesh.  The are 16 entries because it has been shown that
-       there are at most 5 triangles in a cube and each "edge triple" list is
-       terminated with the value -1.
-       For example triTable[3] contains
-       {1, 8, 3, 9, 8, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
-       This corresponds to the case of a cube whose vertex 0 and 1 are inside
-       of the surface and the rest of the verts are outside (00000001 bitwise
-       OR'ed with 00000010 makes 00000011 == 3).  Therefore, this cube is
-       intersected by the surface roughly in the form of a plane which cuts
-       edges 8,9,1 and 3.  This quadrilateral can be constructed from two
-       triangles: one which is made of the intersection vertices found on edges
-       1,8, and 3; the other is formed from the vertices on edges 9,8, and 1.
-       Remember, each intersected edge contains only one surface vertex.  The
-       vertex triples are listed in counter clockwise order for proper facing.
-    */
-    static int triTable[256][16] =
-    {{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 8, 3, 9, 8, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 2, 10, 0, 2, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 8, 3, 2, 10, 8, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1},
-    {3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 11, 2, 8, 11, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 9, 0, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 11, 2, 1, 9, 11, 9, 8, 11, -1, -1, -1, -1, -1, -1, -1},
-    {3, 10, 1, 11, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 10, 1, 0, 8, 10, 8, 11, 10, -1, -1, -1, -1, -1, -1, -1},
-    {3, 9, 0, 3, 11, 9, 11, 10, 9, -1, -1, -1, -1, -1, -1, -1},
-    {9, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 3, 0, 7, 3, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 9, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 1, 9, 4, 7, 1, 7, 3, 1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 4, 7, 3, 0, 4, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1},
-    {9, 2, 10, 9, 0, 2, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1},
-    {2, 10, 9, 2, 9, 7, 2, 7, 3, 7, 9, 4, -1, -1, -1, -1},
-    {8, 4, 7, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {11, 4, 7, 11, 2, 4, 2, 0, 4, -1, -1, -1, -1, -1, -1, -1},
-    {9, 0, 1, 8, 4, 7, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
-    {4, 7, 11, 9, 4, 11, 9, 11, 2, 9, 2, 1, -1, -1, -1, -1},
-    {3, 10, 1, 3, 11, 10, 7, 8, 4, -1, -1, -1, -1, -1, -1, -1},
-    {1, 11, 10, 1, 4, 11, 1, 0, 4, 7, 11, 4, -1, -1, -1, -1},
-    {4, 7, 8, 9, 0, 11, 9, 11, 10, 11, 0, 3, -1, -1, -1, -1},
-    {4, 7, 11, 4, 11, 9, 9, 11, 10, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 4, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 5, 4, 1, 5, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {8, 5, 4, 8, 3, 5, 3, 1, 5, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 8, 1, 2, 10, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
-    {5, 2, 10, 5, 4, 2, 4, 0, 2, -1, -1, -1, -1, -1, -1, -1},
-    {2, 10, 5, 3, 2, 5, 3, 5, 4, 3, 4, 8, -1, -1, -1, -1},
-    {9, 5, 4, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 11, 2, 0, 8, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
-    {0, 5, 4, 0, 1, 5, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
-    {2, 1, 5, 2, 5, 8, 2, 8, 11, 4, 8, 5, -1, -1, -1, -1},
-    {10, 3, 11, 10, 1, 3, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1},
-    {4, 9, 5, 0, 8, 1, 8, 10, 1, 8, 11, 10, -1, -1, -1, -1},
-    {5, 4, 0, 5, 0, 11, 5, 11, 10, 11, 0, 3, -1, -1, -1, -1},
-    {5, 4, 8, 5, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1},
-    {9, 7, 8, 5, 7, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 3, 0, 9, 5, 3, 5, 7, 3, -1, -1, -1, -1, -1, -1, -1},
-    {0, 7, 8, 0, 1, 7, 1, 5, 7, -1, -1, -1, -1, -1, -1, -1},
-    {1, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 7, 8, 9, 5, 7, 10, 1, 2, -1, -1, -1, -1, -1, -1, -1},
-    {10, 1, 2, 9, 5, 0, 5, 3, 0, 5, 7, 3, -1, -1, -1, -1},
-    {8, 0, 2, 8, 2, 5, 8, 5, 7, 10, 5, 2, -1, -1, -1, -1},
-    {2, 10, 5, 2, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1},
-    {7, 9, 5, 7, 8, 9, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 7, 9, 7, 2, 9, 2, 0, 2, 7, 11, -1, -1, -1, -1},
-    {2, 3, 11, 0, 1, 8, 1, 7, 8, 1, 5, 7, -1, -1, -1, -1},
-    {11, 2, 1, 11, 1, 7, 7, 1, 5, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 8, 8, 5, 7, 10, 1, 3, 10, 3, 11, -1, -1, -1, -1},
-    {5, 7, 0, 5, 0, 9, 7, 11, 0, 1, 0, 10, 11, 10, 0, -1},
-    {11, 10, 0, 11, 0, 3, 10, 5, 0, 8, 0, 7, 5, 7, 0, -1},
-    {11, 10, 5, 7, 11, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 0, 1, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 8, 3, 1, 9, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
-    {1, 6, 5, 2, 6, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 6, 5, 1, 2, 6, 3, 0, 8, -1, -1, -1, -1, -1, -1, -1},
-    {9, 6, 5, 9, 0, 6, 0, 2, 6, -1, -1, -1, -1, -1, -1, -1},
-    {5, 9, 8, 5, 8, 2, 5, 2, 6, 3, 2, 8, -1, -1, -1, -1},
-    {2, 3, 11, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {11, 0, 8, 11, 2, 0, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 9, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
-    {5, 10, 6, 1, 9, 2, 9, 11, 2, 9, 8, 11, -1, -1, -1, -1},
-    {6, 3, 11, 6, 5, 3, 5, 1, 3, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 11, 0, 11, 5, 0, 5, 1, 5, 11, 6, -1, -1, -1, -1},
-    {3, 11, 6, 0, 3, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1},
-    {6, 5, 9, 6, 9, 11, 11, 9, 8, -1, -1, -1, -1, -1, -1, -1},
-    {5, 10, 6, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 3, 0, 4, 7, 3, 6, 5, 10, -1, -1, -1, -1, -1, -1, -1},
-    {1, 9, 0, 5, 10, 6, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1},
-    {10, 6, 5, 1, 9, 7, 1, 7, 3, 7, 9, 4, -1, -1, -1, -1},
-    {6, 1, 2, 6, 5, 1, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 5, 5, 2, 6, 3, 0, 4, 3, 4, 7, -1, -1, -1, -1},
-    {8, 4, 7, 9, 0, 5, 0, 6, 5, 0, 2, 6, -1, -1, -1, -1},
-    {7, 3, 9, 7, 9, 4, 3, 2, 9, 5, 9, 6, 2, 6, 9, -1},
-    {3, 11, 2, 7, 8, 4, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1},
-    {5, 10, 6, 4, 7, 2, 4, 2, 0, 2, 7, 11, -1, -1, -1, -1},
-    {0, 1, 9, 4, 7, 8, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1},
-    {9, 2, 1, 9, 11, 2, 9, 4, 11, 7, 11, 4, 5, 10, 6, -1},
-    {8, 4, 7, 3, 11, 5, 3, 5, 1, 5, 11, 6, -1, -1, -1, -1},
-    {5, 1, 11, 5, 11, 6, 1, 0, 11, 7, 11, 4, 0, 4, 11, -1},
-    {0, 5, 9, 0, 6, 5, 0, 3, 6, 11, 6, 3, 8, 4, 7, -1},
-    {6, 5, 9, 6, 9, 11, 4, 7, 9, 7, 11, 9, -1, -1, -1, -1},
-    {10, 4, 9, 6, 4, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 10, 6, 4, 9, 10, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1},
-    {10, 0, 1, 10, 6, 0, 6, 4, 0, -1, -1, -1, -1, -1, -1, -1},
-    {8, 3, 1, 8, 1, 6, 8, 6, 4, 6, 1, 10, -1, -1, -1, -1},
-    {1, 4, 9, 1, 2, 4, 2, 6, 4, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 8, 1, 2, 9, 2, 4, 9, 2, 6, 4, -1, -1, -1, -1},
-    {0, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {8, 3, 2, 8, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1},
-    {10, 4, 9, 10, 6, 4, 11, 2, 3, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 2, 2, 8, 11, 4, 9, 10, 4, 10, 6, -1, -1, -1, -1},
-    {3, 11, 2, 0, 1, 6, 0, 6, 4, 6, 1, 10, -1, -1, -1, -1},
-    {6, 4, 1, 6, 1, 10, 4, 8, 1, 2, 1, 11, 8, 11, 1, -1},
-    {9, 6, 4, 9, 3, 6, 9, 1, 3, 11, 6, 3, -1, -1, -1, -1},
-    {8, 11, 1, 8, 1, 0, 11, 6, 1, 9, 1, 4, 6, 4, 1, -1},
-    {3, 11, 6, 3, 6, 0, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1},
-    {6, 4, 8, 11, 6, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {7, 10, 6, 7, 8, 10, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1},
-    {0, 7, 3, 0, 10, 7, 0, 9, 10, 6, 7, 10, -1, -1, -1, -1},
-    {10, 6, 7, 1, 10, 7, 1, 7, 8, 1, 8, 0, -1, -1, -1, -1},
-    {10, 6, 7, 10, 7, 1, 1, 7, 3, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 6, 1, 6, 8, 1, 8, 9, 8, 6, 7, -1, -1, -1, -1},
-    {2, 6, 9, 2, 9, 1, 6, 7, 9, 0, 9, 3, 7, 3, 9, -1},
-    {7, 8, 0, 7, 0, 6, 6, 0, 2, -1, -1, -1, -1, -1, -1, -1},
-    {7, 3, 2, 6, 7, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 3, 11, 10, 6, 8, 10, 8, 9, 8, 6, 7, -1, -1, -1, -1},
-    {2, 0, 7, 2, 7, 11, 0, 9, 7, 6, 7, 10, 9, 10, 7, -1},
-    {1, 8, 0, 1, 7, 8, 1, 10, 7, 6, 7, 10, 2, 3, 11, -1},
-    {11, 2, 1, 11, 1, 7, 10, 6, 1, 6, 7, 1, -1, -1, -1, -1},
-    {8, 9, 6, 8, 6, 7, 9, 1, 6, 11, 6, 3, 1, 3, 6, -1},
-    {0, 9, 1, 11, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {7, 8, 0, 7, 0, 6, 3, 11, 0, 11, 6, 0, -1, -1, -1, -1},
-    {7, 11, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 8, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 9, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {8, 1, 9, 8, 3, 1, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1},
-    {10, 1, 2, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 3, 0, 8, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
-    {2, 9, 0, 2, 10, 9, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
-    {6, 11, 7, 2, 10, 3, 10, 8, 3, 10, 9, 8, -1, -1, -1, -1},
-    {7, 2, 3, 6, 2, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {7, 0, 8, 7, 6, 0, 6, 2, 0, -1, -1, -1, -1, -1, -1, -1},
-    {2, 7, 6, 2, 3, 7, 0, 1, 9, -1, -1, -1, -1, -1, -1, -1},
-    {1, 6, 2, 1, 8, 6, 1, 9, 8, 8, 7, 6, -1, -1, -1, -1},
-    {10, 7, 6, 10, 1, 7, 1, 3, 7, -1, -1, -1, -1, -1, -1, -1},
-    {10, 7, 6, 1, 7, 10, 1, 8, 7, 1, 0, 8, -1, -1, -1, -1},
-    {0, 3, 7, 0, 7, 10, 0, 10, 9, 6, 10, 7, -1, -1, -1, -1},
-    {7, 6, 10, 7, 10, 8, 8, 10, 9, -1, -1, -1, -1, -1, -1, -1},
-    {6, 8, 4, 11, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 6, 11, 3, 0, 6, 0, 4, 6, -1, -1, -1, -1, -1, -1, -1},
-    {8, 6, 11, 8, 4, 6, 9, 0, 1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 4, 6, 9, 6, 3, 9, 3, 1, 11, 3, 6, -1, -1, -1, -1},
-    {6, 8, 4, 6, 11, 8, 2, 10, 1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 3, 0, 11, 0, 6, 11, 0, 4, 6, -1, -1, -1, -1},
-    {4, 11, 8, 4, 6, 11, 0, 2, 9, 2, 10, 9, -1, -1, -1, -1},
-    {10, 9, 3, 10, 3, 2, 9, 4, 3, 11, 3, 6, 4, 6, 3, -1},
-    {8, 2, 3, 8, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1},
-    {0, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 9, 0, 2, 3, 4, 2, 4, 6, 4, 3, 8, -1, -1, -1, -1},
-    {1, 9, 4, 1, 4, 2, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1},
-    {8, 1, 3, 8, 6, 1, 8, 4, 6, 6, 10, 1, -1, -1, -1, -1},
-    {10, 1, 0, 10, 0, 6, 6, 0, 4, -1, -1, -1, -1, -1, -1, -1},
-    {4, 6, 3, 4, 3, 8, 6, 10, 3, 0, 3, 9, 10, 9, 3, -1},
-    {10, 9, 4, 6, 10, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 9, 5, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 4, 9, 5, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1},
-    {5, 0, 1, 5, 4, 0, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1},
-    {11, 7, 6, 8, 3, 4, 3, 5, 4, 3, 1, 5, -1, -1, -1, -1},
-    {9, 5, 4, 10, 1, 2, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1},
-    {6, 11, 7, 1, 2, 10, 0, 8, 3, 4, 9, 5, -1, -1, -1, -1},
-    {7, 6, 11, 5, 4, 10, 4, 2, 10, 4, 0, 2, -1, -1, -1, -1},
-    {3, 4, 8, 3, 5, 4, 3, 2, 5, 10, 5, 2, 11, 7, 6, -1},
-    {7, 2, 3, 7, 6, 2, 5, 4, 9, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 4, 0, 8, 6, 0, 6, 2, 6, 8, 7, -1, -1, -1, -1},
-    {3, 6, 2, 3, 7, 6, 1, 5, 0, 5, 4, 0, -1, -1, -1, -1},
-    {6, 2, 8, 6, 8, 7, 2, 1, 8, 4, 8, 5, 1, 5, 8, -1},
-    {9, 5, 4, 10, 1, 6, 1, 7, 6, 1, 3, 7, -1, -1, -1, -1},
-    {1, 6, 10, 1, 7, 6, 1, 0, 7, 8, 7, 0, 9, 5, 4, -1},
-    {4, 0, 10, 4, 10, 5, 0, 3, 10, 6, 10, 7, 3, 7, 10, -1},
-    {7, 6, 10, 7, 10, 8, 5, 4, 10, 4, 8, 10, -1, -1, -1, -1},
-    {6, 9, 5, 6, 11, 9, 11, 8, 9, -1, -1, -1, -1, -1, -1, -1},
-    {3, 6, 11, 0, 6, 3, 0, 5, 6, 0, 9, 5, -1, -1, -1, -1},
-    {0, 11, 8, 0, 5, 11, 0, 1, 5, 5, 6, 11, -1, -1, -1, -1},
-    {6, 11, 3, 6, 3, 5, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 9, 5, 11, 9, 11, 8, 11, 5, 6, -1, -1, -1, -1},
-    {0, 11, 3, 0, 6, 11, 0, 9, 6, 5, 6, 9, 1, 2, 10, -1},
-    {11, 8, 5, 11, 5, 6, 8, 0, 5, 10, 5, 2, 0, 2, 5, -1},
-    {6, 11, 3, 6, 3, 5, 2, 10, 3, 10, 5, 3, -1, -1, -1, -1},
-    {5, 8, 9, 5, 2, 8, 5, 6, 2, 3, 8, 2, -1, -1, -1, -1},
-    {9, 5, 6, 9, 6, 0, 0, 6, 2, -1, -1, -1, -1, -1, -1, -1},
-    {1, 5, 8, 1, 8, 0, 5, 6, 8, 3, 8, 2, 6, 2, 8, -1},
-    {1, 5, 6, 2, 1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 3, 6, 1, 6, 10, 3, 8, 6, 5, 6, 9, 8, 9, 6, -1},
-    {10, 1, 0, 10, 0, 6, 9, 5, 0, 5, 6, 0, -1, -1, -1, -1},
-    {0, 3, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {10, 5, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {11, 5, 10, 7, 5, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {11, 5, 10, 11, 7, 5, 8, 3, 0, -1, -1, -1, -1, -1, -1, -1},
-    {5, 11, 7, 5, 10, 11, 1, 9, 0, -1, -1, -1, -1, -1, -1, -1},
-    {10, 7, 5, 10, 11, 7, 9, 8, 1, 8, 3, 1, -1, -1, -1, -1},
-    {11, 1, 2, 11, 7, 1, 7, 5, 1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 1, 2, 7, 1, 7, 5, 7, 2, 11, -1, -1, -1, -1},
-    {9, 7, 5, 9, 2, 7, 9, 0, 2, 2, 11, 7, -1, -1, -1, -1},
-    {7, 5, 2, 7, 2, 11, 5, 9, 2, 3, 2, 8, 9, 8, 2, -1},
-    {2, 5, 10, 2, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1},
-    {8, 2, 0, 8, 5, 2, 8, 7, 5, 10, 2, 5, -1, -1, -1, -1},
-    {9, 0, 1, 5, 10, 3, 5, 3, 7, 3, 10, 2, -1, -1, -1, -1},
-    {9, 8, 2, 9, 2, 1, 8, 7, 2, 10, 2, 5, 7, 5, 2, -1},
-    {1, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 7, 0, 7, 1, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1},
-    {9, 0, 3, 9, 3, 5, 5, 3, 7, -1, -1, -1, -1, -1, -1, -1},
-    {9, 8, 7, 5, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {5, 8, 4, 5, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1},
-    {5, 0, 4, 5, 11, 0, 5, 10, 11, 11, 3, 0, -1, -1, -1, -1},
-    {0, 1, 9, 8, 4, 10, 8, 10, 11, 10, 4, 5, -1, -1, -1, -1},
-    {10, 11, 4, 10, 4, 5, 11, 3, 4, 9, 4, 1, 3, 1, 4, -1},
-    {2, 5, 1, 2, 8, 5, 2, 11, 8, 4, 5, 8, -1, -1, -1, -1},
-    {0, 4, 11, 0, 11, 3, 4, 5, 11, 2, 11, 1, 5, 1, 11, -1},
-    {0, 2, 5, 0, 5, 9, 2, 11, 5, 4, 5, 8, 11, 8, 5, -1},
-    {9, 4, 5, 2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 5, 10, 3, 5, 2, 3, 4, 5, 3, 8, 4, -1, -1, -1, -1},
-    {5, 10, 2, 5, 2, 4, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1},
-    {3, 10, 2, 3, 5, 10, 3, 8, 5, 4, 5, 8, 0, 1, 9, -1},
-    {5, 10, 2, 5, 2, 4, 1, 9, 2, 9, 4, 2, -1, -1, -1, -1},
-    {8, 4, 5, 8, 5, 3, 3, 5, 1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 4, 5, 1, 0, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {8, 4, 5, 8, 5, 3, 9, 0, 5, 0, 3, 5, -1, -1, -1, -1},
-    {9, 4, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 11, 7, 4, 9, 11, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 4, 9, 7, 9, 11, 7, 9, 10, 11, -1, -1, -1, -1},
-    {1, 10, 11, 1, 11, 4, 1, 4, 0, 7, 4, 11, -1, -1, -1, -1},
-    {3, 1, 4, 3, 4, 8, 1, 10, 4, 7, 4, 11, 10, 11, 4, -1},
-    {4, 11, 7, 9, 11, 4, 9, 2, 11, 9, 1, 2, -1, -1, -1, -1},
-    {9, 7, 4, 9, 11, 7, 9, 1, 11, 2, 11, 1, 0, 8, 3, -1},
-    {11, 7, 4, 11, 4, 2, 2, 4, 0, -1, -1, -1, -1, -1, -1, -1},
-    {11, 7, 4, 11, 4, 2, 8, 3, 4, 3, 2, 4, -1, -1, -1, -1},
-    {2, 9, 10, 2, 7, 9, 2, 3, 7, 7, 4, 9, -1, -1, -1, -1},
-    {9, 10, 7, 9, 7, 4, 10, 2, 7, 8, 7, 0, 2, 0, 7, -1},
-    {3, 7, 10, 3, 10, 2, 7, 4, 10, 1, 10, 0, 4, 0, 10, -1},
-    {1, 10, 2, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 9, 1, 4, 1, 7, 7, 1, 3, -1, -1, -1, -1, -1, -1, -1},
-    {4, 9, 1, 4, 1, 7, 0, 8, 1, 8, 7, 1, -1, -1, -1, -1},
-    {4, 0, 3, 7, 4, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 9, 3, 9, 11, 11, 9, 10, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 10, 0, 10, 8, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1},
-    {3, 1, 10, 11, 3, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 11, 1, 11, 9, 9, 11, 8, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 9, 3, 9, 11, 1, 2, 9, 2, 11, 9, -1, -1, -1, -1},
-    {0, 2, 11, 8, 0, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 2, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 3, 8, 2, 8, 10, 10, 8, 9, -1, -1, -1, -1, -1, -1, -1},
-    {9, 10, 2, 0, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 3, 8, 2, 8, 10, 0, 1, 8, 1, 10, 8, -1, -1, -1, -1},
-    {1, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 3, 8, 9, 1, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 9, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}};
-
-    int i,ntri = 0;
-    int cubeindex;
-    glm::vec3 vertlist[12];
     // Determine the index into the edge table which tells us which vertices are inside of the surface
+    unsigned int cubeindex = 0;
+    for (unsigned int c = 0; c < 8; c++)
+    {
+        if (g.val[c] < iso) cubeindex |= 1u << c;
+    }
 
-    cubeindex = 0;
-    if (g.val[0] < iso) cubeindex |= 1;
-    if (g.val[1] < iso) cubeindex |= 2;
-    if (g.val[2] < iso) cubeindex |= 4;
-    if (g.val[3] < iso) cubeindex |= 8;
-    if (g.val[4] < iso) cubeindex |= 16;
-    if (g.val[5] < iso) cubeindex |= 32;
-    if (g.val[6] < iso) cubeindex |= 64;
-    if (g.val[7] < iso) cubeindex |= 128;
-
-   /* Cube is entirely in/out of the surface */
-    if (edgeTable[cubeindex] == 0)
+    /* Cube is entirely in/out of the surface */
+    const unsigned int edges = c_cellEdgeMask[cubeindex];
+    if (edges == 0)
         return(0);
 
-   /* Find the vertices where the surface intersects the cube */
-   if (edgeTable[cubeindex] & 1) {
-      vertlist[0] = VertexInterp(iso,g.p[0],g.p[1],g.val[0],g.val[1]);
-   }
-   if (edgeTable[cubeindex] & 2) {
-      vertlist[1] = VertexInterp(iso,g.p[1],g.p[2],g.val[1],g.val[2]);
-   }
-   if (edgeTable[cubeindex] & 4) {
-      vertlist[2] = VertexInterp(iso,g.p[2],g.p[3],g.val[2],g.val[3]);
-   }
-   if (edgeTable[cubeindex] & 8) {
-      vertlist[3] = VertexInterp(iso,g.p[3],g.p[0],g.val[3],g.val[0]);
-   }
-   if (edgeTable[cubeindex] & 16) {
-      vertlist[4] = VertexInterp(iso,g.p[4],g.p[5],g.val[4],g.val[5]);
-   }
-   if (edgeTable[cubeindex] & 32) {
-      vertlist[5] = VertexInterp(iso,g.p[5],g.p[6],g.val[5],g.val[6]);
-   }
-   if (edgeTable[cubeindex] & 64) {
-      vertlist[6] = VertexInterp(iso,g.p[6],g.p[7],g.val[6],g.val[7]);
-   }
-   if (edgeTable[cubeindex] & 128) {
-      vertlist[7] = VertexInterp(iso,g.p[7],g.p[4],g.val[7],g.val[4]);
-   }
-   if (edgeTable[cubeindex] & 256) {
-      vertlist[8] = VertexInterp(iso,g.p[0],g.p[4],g.val[0],g.val[4]);
-   }
-   if (edgeTable[cubeindex] & 512) {
-      vertlist[9] = VertexInterp(iso,g.p[1],g.p[5],g.val[1],g.val[5]);
-   }
-   if (edgeTable[cubeindex] & 1024) {
-      vertlist[10] = VertexInterp(iso,g.p[2],g.p[6],g.val[2],g.val[6]);
-   }
-   if (edgeTable[cubeindex] & 2048) {
-      vertlist[11] = VertexInterp(iso,g.p[3],g.p[7],g.val[3],g.val[7]);
-   }
+    /* Find the vertices where the surface intersects the cube */
+    glm::vec3 vertlist[12];
+    for (unsigned int e = 0; e < 12; e++)
+    {
+        if (edges & (1u << e))
+            vertlist[e] = VertexInterp(iso, g.p[c_edgeCorners[e][0]], g.p[c_edgeCorners[e][1]],
+                                       g.val[c_edgeCorners[e][0]], g.val[c_edgeCorners[e][1]]);
+    }
 
     TRIANGLE     tri;
+    unsigned int ntri = 0;
     /* Create the triangles */
-    for (i=0;triTable[cubeindex][i]!=-1;i+=3)
+    for (int i = 0; c_cellTriangles[cubeindex][i] != -1; i += 3)
     {
-        tri.p[0] = vertlist[triTable[cubeindex][i  ]];
-        tri.p[1] = vertlist[triTable[cubeindex][i+1]];
-        tri.p[2] = vertlist[triTable[cubeindex][i+2]];
+        tri.p[0] = vertlist[c_cellTriangles[cubeindex][i  ]];
+        tri.p[1] = vertlist[c_cellTriangles[cubeindex][i+1]];
+        tri.p[2] = vertlist[c_cellTriangles[cubeindex][i+2]];
         triList.push_back(tri);
         ntri++;
     }
@@ -808,10 +2041,24 @@ unsigned int MarchingCube::MarchingTriangles(GRIDCELL g, float iso, std::vector<
     return(ntri);
 }
 
-/*-------------------------------------------------------------------------
-   Return the point between two points in the same ratio as
-   isolevel is between valp1 and valp2
-*/
+unsigned int MarchingCube::polygonizeCell(const float *_plane0, const float *_plane1, unsigned int _rowSize,
+                                          unsigned int _first, const glm::vec3 &_origin, std::vector<TRIANGLE> &o_triangles) const
+{
+    glm::vec3 vertices[15];
+    const unsigned int noTriangles = m_singlePrecision ?
+                marchCell<float>(_plane0, _plane1, _rowSize, _first, _origin, isolevel, vertices) :
+                marchCell<double>(_plane0, _plane1, _rowSize, _first, _origin, isolevel, vertices);
+    for (unsigned int t = 0; t < noTriangles; t++)
+    {
+        TRIANGLE tri;
+        tri.p[0] = vertices[t*3];
+        tri.p[1] = vertices[t*3 + 1];
+        tri.p[2] = vertices[t*3 + 2];
+        o_triangles.push_back(tri);
+    }
+    return noTriangles;
+}
+
 glm::vec3 MarchingCube::VertexInterp(double isolevel,glm::vec3 p1,glm::vec3 p2,double valp1,double valp2)
 {
     float       mu;
@@ -845,11 +2092,12 @@ glm::vec3 MarchingCube::computeTriangleNormal(TRIANGLE  &itr)
     return norm;
 }
 
-void MarchingCube::write(std::vector<float> const & _vertices, std::vector<float>const & _normals, std::string _destination)
+bool MarchingCube::write(std::vector<float> const & _vertices, std::vector<float>const & _normals, std::string _destination)
 {
     std::ofstream out;
     out.open(_destination);
-    out.clear();
+    if(!out)
+        return false;
     for(unsigned int i = 0; i < _vertices.size(); i+=3)
     {
         out << "v " << _vertices[i] << " " << _vertices[i+1] << " " << _vertices[i+2] << "\n";
@@ -863,10 +2111,49 @@ void MarchingCube::write(std::vector<float> const & _vertices, std::vector<float
     {
         out << "f " << (i*3)+1 << "//"<< (i*3)+1 << " " << (i*3)+2 << "//" << (i*3)+2 << " " << (i*3)+3 << "//" << (i*3)+3 << "\n";
     }
-}
-
 
+    out.close();
+    return bool(out);
+}
 
+bool MarchingCube::write(const std::vector<float> &_vertices, const std::vector<float> &_normals, const std::vector<unsigned int> &_indices, std::string _destination)
+{
+    std::ofstream out;
+    out.open(_destination);
+    if(!out)
+        return false;
+    for(unsigned int i = 0; i < _vertices.size(); i+=3)
+    {
+        out << "v " << _vertices[i] << " " << _vertices[i+1] << " " << _vertices[i+2] << "\n";
+    }
+    for(unsigned int i = 0; i < _normals.size(); i+=3)
+    {
+        out << "vn " << _normals[i] << " " << _normals[i+1] << " " << _normals[i+2] << "\n";
+    }
 
+    // vertices and normals share their index
+    for(unsigned int i = 0; i + 2 < _indices.size(); i+=3)
+    {
+        unsigned int a = _indices[i]+1, b = _indices[i+1]+1, c = _indices[i+2]+1;
+        out << "f " << a << "//" << a << " " << b << "//" << b << " " << c << "//" << c << "\n";
+    }
 
+    out.close();
+    return bool(out);
+}
 
+bool MarchingCube::writeBinary(const std::vector<float> &_vertices, const std::vector<float> &_normals, const std::vector<unsigned int> &_indices, std::string _destination)
+{
+    std::ofstream out(_destination, std::ios::binary | std::ios::trunc);
+    if(!out)
+        return false;
+
+    const uint32_t counts[2] = {uint32_t(_vertices.size()/3), uint32_t(_indices.size())};
+    out.write("IMSH", 4);
+    out.write(reinterpret_cast<const char *>(counts), sizeof(counts));
+    out.write(reinterpret_cast<const char *>(_vertices.data()), _vertices.size()*sizeof(float));
+    out.write(reinterpret_cast<const char *>(_normals.data()), _normals.size()*sizeof(float));
+    out.write(reinterpret_cast<const char *>(_indices.data()), _indices.size()*sizeof(unsigned int));
+
+    return bool(out);
+}